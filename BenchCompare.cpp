@@ -0,0 +1,349 @@
+#include <stdio.h>
+#include <string.h>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+/*
+ * Compares two CSV files written by Performance --csv. Runs are grouped by
+ * variant, thread count, op mix and key range. A group regresses when mean
+ * throughput drops by more than the threshold percent and Welch's t-test
+ * says the drop is significant after a Holm-Bonferroni correction across
+ * every group. Exits 1 if any group regresses, has fewer than the minimum
+ * runs on either side, or is missing from the candidate.
+ */
+
+#define DEFAULT_THRESHOLD 5.0
+#define DEFAULT_MIN_RUNS 3
+#define DEFAULT_ALPHA 0.05
+
+struct Samples
+{
+	std::vector<double> throughput;
+	std::vector<double> p99;
+};
+
+typedef std::map<std::string, Samples> ResultSet;
+
+std::vector<std::string> SplitCsvLine (const char* line)
+{
+	std::vector<std::string> fields;
+	std::string field;
+	for (const char* c = line; *c != '\0' && *c != '\n' && *c != '\r'; c++)
+	{
+		if (*c == ',')
+		{
+			fields.push_back (field);
+			field.clear ();
+		}
+		else
+			field += *c;
+	}
+	fields.push_back (field);
+	return fields;
+}
+
+int FindColumn (const std::vector<std::string>& header, const char* name)
+{
+	for (size_t i = 0; i < header.size (); i++)
+		if (header[i] == name)
+			return (int)i;
+	return -1;
+}
+
+bool LoadResults (const char* path, ResultSet& results)
+{
+	FILE* file = fopen (path, "r");
+	if (file == NULL)
+	{
+		printf ("[ERROR] Could not open %s\n", path);
+		return false;
+	}
+
+	char line [1024];
+	if (fgets (line, sizeof (line), file) == NULL)
+	{
+		printf ("[ERROR] %s is empty\n", path);
+		fclose (file);
+		return false;
+	}
+
+	std::vector<std::string> header = SplitCsvLine (line);
+	const char* keyNames [] = {"variant", "threads", "add", "remove", "contains", "key_range"};
+	int keyColumns [6];
+	for (int i = 0; i < 6; i++)
+		keyColumns[i] = FindColumn (header, keyNames[i]);
+	int throughputColumn = FindColumn (header, "throughput");
+	int p99Column = FindColumn (header, "p99_ns");
+
+	bool missing = throughputColumn < 0 || p99Column < 0;
+	for (int i = 0; i < 6; i++)
+		missing |= keyColumns[i] < 0;
+
+	if (missing)
+	{
+		printf ("[ERROR] %s is missing required columns\n", path);
+		fclose (file);
+		return false;
+	}
+
+	while (fgets (line, sizeof (line), file) != NULL)
+	{
+		std::vector<std::string> fields = SplitCsvLine (line);
+		if (fields.size () != header.size ())
+			continue;
+
+		std::string key = fields[keyColumns[0]];
+		key += " threads=" + fields[keyColumns[1]];
+		key += " mix=" + fields[keyColumns[2]] + "/" + fields[keyColumns[3]] + "/" + fields[keyColumns[4]];
+		key += " range=" + fields[keyColumns[5]];
+
+		results[key].throughput.push_back (atof (fields[throughputColumn].c_str ()));
+		results[key].p99.push_back (atof (fields[p99Column].c_str ()));
+	}
+
+	fclose (file);
+	return true;
+}
+
+double Mean (const std::vector<double>& values)
+{
+	double sum = 0;
+	for (size_t i = 0; i < values.size (); i++)
+		sum += values[i];
+	return sum / values.size ();
+}
+
+double Variance (const std::vector<double>& values, double mean)
+{
+	if (values.size () < 2)
+		return 0;
+
+	double sum = 0;
+	for (size_t i = 0; i < values.size (); i++)
+		sum += (values[i] - mean) * (values[i] - mean);
+	return sum / (values.size () - 1);
+}
+
+// Continued fraction for the incomplete beta function, evaluated with Lentz's method
+double BetaContinuedFraction (double a, double b, double x)
+{
+	const double tiny = 1e-300;
+	double c = 1;
+	double d = 1 - (a + b) * x / (a + 1);
+	if (fabs (d) < tiny)
+		d = tiny;
+	d = 1 / d;
+	double result = d;
+
+	for (int m = 1; m <= 200; m++)
+	{
+		// Even step
+		double numerator = m * (b - m) * x / ((a + 2 * m - 1) * (a + 2 * m));
+		d = 1 + numerator * d;
+		c = 1 + numerator / c;
+		if (fabs (d) < tiny)
+			d = tiny;
+		if (fabs (c) < tiny)
+			c = tiny;
+		d = 1 / d;
+		result *= d * c;
+
+		// Odd step
+		numerator = -(a + m) * (a + b + m) * x / ((a + 2 * m) * (a + 2 * m + 1));
+		d = 1 + numerator * d;
+		c = 1 + numerator / c;
+		if (fabs (d) < tiny)
+			d = tiny;
+		if (fabs (c) < tiny)
+			c = tiny;
+		d = 1 / d;
+		double delta = d * c;
+		result *= delta;
+
+		if (fabs (delta - 1) < 1e-12)
+			break;
+	}
+
+	return result;
+}
+
+// Regularized incomplete beta function I_x (a, b)
+double RegularizedBeta (double a, double b, double x)
+{
+	if (x <= 0)
+		return 0;
+	if (x >= 1)
+		return 1;
+
+	double front = exp (lgamma (a + b) - lgamma (a) - lgamma (b) + a * log (x) + b * log (1 - x));
+
+	// The continued fraction converges quickly on this side, use symmetry otherwise
+	if (x < (a + 1) / (a + b + 2))
+		return front * BetaContinuedFraction (a, b, x) / a;
+	return 1 - front * BetaContinuedFraction (b, a, 1 - x) / b;
+}
+
+// Two sided p-value of Welch's t-test, samples need at least 2 runs each
+double WelchPValue (const std::vector<double>& a, const std::vector<double>& b)
+{
+	double meanA = Mean (a);
+	double meanB = Mean (b);
+	double errorA = Variance (a, meanA) / a.size ();
+	double errorB = Variance (b, meanB) / b.size ();
+
+	if (errorA + errorB == 0)
+		return (meanA == meanB) ? 1.0 : 0.0;
+
+	double t = (meanA - meanB) / sqrt (errorA + errorB);
+	double df = (errorA + errorB) * (errorA + errorB) /
+		(errorA * errorA / (a.size () - 1) + errorB * errorB / (b.size () - 1));
+
+	return RegularizedBeta (df / 2, 0.5, df / (df + t * t));
+}
+
+struct Comparison
+{
+	std::string name;
+	double baseMean;
+	double nextMean;
+	double change;
+	double p99Change;
+	double pValue;
+	bool enoughRuns;
+	bool significant;
+};
+
+bool ByPValue (const Comparison* a, const Comparison* b)
+{
+	return a->pValue < b->pValue;
+}
+
+// Holm-Bonferroni step down, keeps the chance of any false verdict across all
+// configurations at alpha instead of alpha per configuration
+void HolmCorrection (std::vector<Comparison>& comparisons, double alpha)
+{
+	std::vector<Comparison*> ordered;
+	for (size_t i = 0; i < comparisons.size (); i++)
+		if (comparisons[i].enoughRuns)
+			ordered.push_back (&comparisons[i]);
+
+	std::sort (ordered.begin (), ordered.end (), ByPValue);
+
+	for (size_t i = 0; i < ordered.size (); i++)
+	{
+		if (ordered[i]->pValue > alpha / (ordered.size () - i))
+			break;
+		ordered[i]->significant = true;
+	}
+}
+
+void PrintUsage (const char* program)
+{
+	printf ("Usage: %s BASELINE.csv CANDIDATE.csv [--threshold PERCENT] [--min-runs N] [--alpha A]\n", program);
+}
+
+int main (int argc, char** argv)
+{
+	if (argc < 3)
+	{
+		PrintUsage (argv[0]);
+		return 2;
+	}
+
+	double threshold = DEFAULT_THRESHOLD;
+	int minRuns = DEFAULT_MIN_RUNS;
+	double alpha = DEFAULT_ALPHA;
+	for (int i = 3; i < argc; i++)
+	{
+		if (i + 1 < argc && strcmp (argv[i], "--threshold") == 0)
+			threshold = atof (argv[++i]);
+		else if (i + 1 < argc && strcmp (argv[i], "--min-runs") == 0)
+			minRuns = atoi (argv[++i]);
+		else if (i + 1 < argc && strcmp (argv[i], "--alpha") == 0)
+			alpha = atof (argv[++i]);
+		else
+		{
+			PrintUsage (argv[0]);
+			return 2;
+		}
+	}
+
+	// Welch's test needs a variance on both sides
+	if (minRuns < 2 || alpha <= 0 || alpha >= 1)
+	{
+		PrintUsage (argv[0]);
+		return 2;
+	}
+
+	ResultSet baseline;
+	ResultSet candidate;
+	if (!LoadResults (argv[1], baseline) || !LoadResults (argv[2], candidate))
+		return 2;
+
+	std::vector<Comparison> comparisons;
+	std::vector<std::string> missing;
+	for (ResultSet::iterator it = baseline.begin (); it != baseline.end (); ++it)
+	{
+		ResultSet::iterator match = candidate.find (it->first);
+		if (match == candidate.end ())
+		{
+			missing.push_back (it->first);
+			continue;
+		}
+
+		Samples& base = it->second;
+		Samples& next = match->second;
+
+		Comparison c;
+		c.name = it->first;
+		c.baseMean = Mean (base.throughput);
+		c.nextMean = Mean (next.throughput);
+		c.change = (c.nextMean - c.baseMean) / c.baseMean * 100.0;
+		c.p99Change = (Mean (next.p99) - Mean (base.p99)) / Mean (base.p99) * 100.0;
+		c.enoughRuns = (int)base.throughput.size () >= minRuns && (int)next.throughput.size () >= minRuns;
+		c.pValue = c.enoughRuns ? WelchPValue (base.throughput, next.throughput) : 1.0;
+		c.significant = false;
+		comparisons.push_back (c);
+	}
+
+	HolmCorrection (comparisons, alpha);
+
+	int regressions = 0;
+	int inconclusive = 0;
+
+	printf ("%-48s %14s %14s %9s %9s %9s %s\n", "configuration", "base ops/s", "new ops/s", "change", "p99", "p", "verdict");
+	for (size_t i = 0; i < comparisons.size (); i++)
+	{
+		Comparison& c = comparisons[i];
+
+		const char* verdict = "ok";
+		if (!c.enoughRuns)
+		{
+			verdict = "too few runs";
+			inconclusive++;
+		}
+		else if (c.change < -threshold && c.significant)
+		{
+			verdict = "REGRESSION";
+			regressions++;
+		}
+		else if (c.change > threshold && c.significant)
+			verdict = "improved";
+
+		printf ("%-48s %14.0lf %14.0lf %+8.1lf%% %+8.1lf%% %9.4lf %s\n",
+			c.name.c_str (), c.baseMean, c.nextMean, c.change, c.p99Change, c.pValue, verdict);
+	}
+
+	for (size_t i = 0; i < missing.size (); i++)
+		printf ("%-48s MISSING from %s\n", missing[i].c_str (), argv[2]);
+
+	printf ("\nCompared %d configurations, %d regression(s) beyond %.1lf%% at alpha %.3lf (Holm corrected), %d with fewer than %d runs, %d missing\n",
+		(int)comparisons.size (), regressions, threshold, alpha, inconclusive, minRuns, (int)missing.size ());
+
+	// A configuration that could not be checked fails the comparison too
+	return (regressions > 0 || inconclusive > 0 || !missing.empty ()) ? 1 : 0;
+}
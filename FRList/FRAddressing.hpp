@@ -0,0 +1,75 @@
+#ifndef FR_ADDRESSING_H
+#define FR_ADDRESSING_H
+
+#include <atomic>
+#include <stdint.h>
+#include <stddef.h>
+
+// Stores FRNode references as plain addresses
+struct FRRawAddressing
+{
+	static uintptr_t Encode (void* p)
+	{
+		return (uintptr_t)p;
+	}
+
+	static void* Decode (uintptr_t value)
+	{
+		return (void*)value;
+	}
+};
+
+// Stores FRNode references as offsets from a per process segment base so they
+// mean the same thing in every process mapping the segment. Offset 0 is NULL,
+// the segment must keep its own header there. Tag allows more than one segment.
+template <class Tag>
+struct FRSegmentAddressing
+{
+	static char*& Base ()
+	{
+		static char* base = NULL;
+		return base;
+	}
+
+	static uintptr_t Encode (void* p)
+	{
+		return (p == NULL) ? 0 : (uintptr_t)((char*)p - Base ());
+	}
+
+	static void* Decode (uintptr_t value)
+	{
+		return (value == 0) ? NULL : (void*)(Base () + value);
+	}
+};
+
+// Default addressing is declared once here for every FRNode related template
+template <class T, class Addressing = FRRawAddressing>
+class FRNode;
+
+template <class T, class Addressing = FRRawAddressing>
+class MarkableReference;
+
+// Atomic reference to N stored through an addressing policy
+template <class N, class Addressing>
+class AtomicLink
+{
+	public:
+		std::atomic<uintptr_t> value;
+
+		N* load ()
+		{
+			return (N*)Addressing::Decode (value.load ());
+		}
+
+		void store (N* n)
+		{
+			value.store (Addressing::Encode (n));
+		}
+
+		operator N* ()
+		{
+			return load ();
+		}
+};
+
+#endif
@@ -11,90 +11,218 @@
 #define FRList_H
 
 #include <atomic>
-#include <climits>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <pthread.h>
+#include <stdio.h>
+#include <type_traits>
 #include "MarkableReference.hpp"
 #include "FRNode.hpp"
 #include "Window.hpp"
+#include "SparseIndex.hpp"
+#include "FRPolicy.hpp"
+#include "FlatCombiner.hpp"
 
-#define FRL_DEBUG false
-
-#define EPSILON 1
-
-#define CAS(exp, succ) compare_exchange_weak(exp, succ)
-
-template <class T>
+template <class T, class Policy = FRDefaultPolicy<T> >
 class FRList
 {
+	public:
+		typedef T Key;
+		typedef typename Policy::Traits Traits;
+		typedef typename Policy::Addressing Addressing;
+		typedef typename Policy::Allocator Allocator;
+		typedef typename Policy::Reclaimer Reclaimer;
+		typedef typename Policy::Backoff Backoff;
+		typedef typename Policy::Stats Stats;
+		typedef typename Policy::Contention Contention;
+		typedef FRNode<T, Addressing> Node;
+		static const bool Debug = Policy::Debug;
+
 	private:
-		FRNode<T>* head;
-		FRNode<T>* tail;
+		static const int INDEX_READER_SHARDS = 16;
+
+		// Readers of the index spread over shards so they do not share one counter.
+		// Padded rather than aligned so FRList can still be created with new in C++11,
+		// counters 64 bytes apart never share a cache line either way.
+		struct ReaderShard
+		{
+			std::atomic<int> count;
+			char padding [64 - sizeof (std::atomic<int>)];
+		};
+
+		Node* head;
+		Node* tail;
+		bool ownsSentinels;// False when attached to sentinels made elsewhere
+		Stats stats;
+		Contention contention;
+
+		// Optional shortcuts maintained by a background thread, NULL when disabled
+		std::atomic<SparseIndex<T, Traits, Addressing>*> index;
+		std::atomic<unsigned int> indexEpoch;
+		ReaderShard indexReaders [2][INDEX_READER_SHARDS];// Indexed by epoch parity
+		std::atomic<bool> indexRebuilding;
+		std::atomic<bool> indexRunning;
+		pthread_t indexThread;
+		int indexStride;
+		unsigned int indexIntervalMs;
+
+	static bool LessOrEqual (T a, T b)
+	{
+		return !Traits::Less (b, a);
+	}
+
+	static bool Equal (T a, T b)
+	{
+		return !Traits::Less (a, b) && !Traits::Less (b, a);
+	}
+
+	// Keys equal to a sentinel can never be stored
+	static bool InRange (T data)
+	{
+		return Traits::Less (Traits::Min (), data) && Traits::Less (data, Traits::Max ());
+	}
 
 	void PrintList ()
 	{
-		FRNode<T>* curr = head;
+		Node* curr = head;
 
 		printf ("========== Printing List ==========\n");
 		while (curr != NULL)
 		{
-			printf ("\t(data %d, addr[%p], next[%p], succ %d, mark %d)\n", curr->data, curr, curr->next.GetReference(), curr->next.IsSuccessorMarked(), curr->next.IsMarkedForDeletion());
+			printf ("\t(data %s, addr[%p], next[%p], succ %d, mark %d)\n", FRFormatKey (curr->data).text, curr, curr->next.GetReference(), curr->next.IsSuccessorMarked(), curr->next.IsMarkedForDeletion());
 			curr = curr->next.GetReference ();
 		}
 	}
 
-	void HelpMarkedForDeletion (FRNode<T>* prev, FRNode<T>* del)
+	// Pick the closest live FRNode with key <= data to start a search from
+	Node* SearchStart (T data)
+	{
+		if (index.load () == NULL)
+			return head;
+
+		// Readers are counted under the current epoch so a swapped out index is not freed under them
+		std::atomic<int>& readers = indexReaders[indexEpoch.load () & 1][ReaderShardId ()].count;
+		readers.fetch_add (1);
+		SparseIndex<T, Traits, Addressing>* current = index.load ();
+		Node* start = (current == NULL) ? NULL : current->Find (data);
+		readers.fetch_sub (1, std::memory_order_release);
+
+		if (start == NULL)
+			return head;
+
+		// Shortcut was deleted since the index was built, back up to a live FRNode
+		while (start != NULL && start->next.IsMarkedForDeletion ())
+		{
+			stats.Backtrack ();
+			start = start->backlink;
+		}
+
+		if (Policy::Debug)
+			printf ("SearchStart (%s) using shortcut [%p]\n", FRFormatKey (data).text, start);
+
+		return (start == NULL) ? head : start;
+	}
+
+	// Each thread sticks to one shard, handed out round robin
+	static int ReaderShardId ()
+	{
+		static std::atomic<unsigned int> nextShard (0);
+		static thread_local int shard = (int)(nextShard.fetch_add (1, std::memory_order_relaxed) % INDEX_READER_SHARDS);
+		return shard;
+	}
+
+	// Frees an index that was just swapped out. Flipping the epoch twice and
+	// draining the old parity each time waits out every reader that could have
+	// loaded it, while new readers count under the other parity, so the wait
+	// is bounded by the readers already inside SearchStart.
+	void ReclaimIndex (SparseIndex<T, Traits, Addressing>* old)
+	{
+		for (int flip = 0; flip < 2; flip++)
+		{
+			unsigned int parity = indexEpoch.fetch_add (1) & 1;
+			for (int i = 0; i < INDEX_READER_SHARDS; i++)
+				while (indexReaders[parity][i].count.load () != 0)
+					std::this_thread::yield ();
+		}
+
+		delete old;
+	}
+
+	static void* IndexThreadLogic (void* listArg)
+	{
+		FRList<T, Policy>* list = (FRList<T, Policy>*)listArg;
+
+		while (list->indexRunning.load ())
+		{
+			list->RebuildIndex (list->indexStride);
+			std::this_thread::sleep_for (std::chrono::milliseconds (list->indexIntervalMs));
+		}
+
+		return NULL;
+	}
+
+	void HelpMarkedForDeletion (Node* prev, Node* del)
 	{
-		if (FRL_DEBUG)
+		if (Policy::Debug)
 			printf ("Called HelpMarkedForDeletion (prev [%p], del [%p])\n", prev, del);
 
 		// Attempt to pysically delete the marked FRNode and unflag prev
-		FRNode<T>* next = del->next.GetReference();
+		Node* next = del->next.GetReference();
 
-		if (FRL_DEBUG)
+		if (Policy::Debug)
 			printf ("Attempting CAS (exp[%p], success[%p], expSucc %d, successSucc %d, expDel %d, successDel %d\n",
 				del, next, true, false, false, false);
 
 		// Expect successor flag and set it to false
-		prev->next.CompareAndSet (del, next, true, false, false, false);
+		prev->next.template CompareAndSet<Policy::Debug> (del, next, true, false, false, false);
 	}
 
-	Window<T> SearchFrom (T data, FRNode<T>* from)
+	Window<T, Addressing> SearchFrom (T data, Node* from)
 	{
-		if (FRL_DEBUG)
-			printf ("Called SearchFrom (%d, [%p])\n", data, from);
+		if (Policy::Debug)
+			printf ("Called SearchFrom (%s, [%p])\n", FRFormatKey (data).text, from);
 
 		// Find two consecutive FRNode such that n1.key <= t.key < n2
-		FRNode<T>* curr = from;
-		FRNode<T>* next = from->next.GetReference ();
-		while (next->data <= data)
+		Node* curr = from;
+		Node* next = from->next.GetReference ();
+		while (LessOrEqual (next->data, data))
 		{
-			if (FRL_DEBUG)
+			if (Policy::Debug)
 			{
-				printf ("\tSearchFrom Loop - curr (%d)[%p][%p], next (%d)[%p][%p]\n", curr->data, curr, curr->next.GetReference(), next->data, next, next->next.GetReference());
+				printf ("\tSearchFrom Loop - curr (%s)[%p][%p], next (%s)[%p][%p]\n", FRFormatKey (curr->data).text, curr, curr->next.GetReference(), FRFormatKey (next->data).text, next, next->next.GetReference());
 			}
-			while (next->next.IsMarkedForDeletion () &&
-					(!curr->next.IsMarkedForDeletion () || curr->next.GetReference () != next))
+			while (next->next.IsMarkedForDeletion ())
 			{
-				if (curr->next.GetReference () == next)
+				// Mark and reference of curr have to come from the same load
+				uintptr_t seen = curr->next.Load ();
+				if (curr->next.GetReference (seen) == next)
+				{
+					if (curr->next.IsMarkedForDeletion (seen))
+						break;
 					HelpMarkedForDeletion (curr, next);
+				}
 				next = curr->next.GetReference ();
 			}
-			if (next->data <= data)// Move down list
+			if (LessOrEqual (next->data, data))// Move down list
 			{
 				curr = next;
 				next = curr->next.GetReference ();
 			}
 		}
 
-		Window<T> w (curr, next);
+		Window<T, Addressing> w (curr, next);
 
 		return w;
 	}
 
-	void HelpSuccessorFlagged (FRNode<T>* prev, FRNode<T>* del)
+	void HelpSuccessorFlagged (Node* prev, Node* del)
 	{
-		if (FRL_DEBUG)
+		if (Policy::Debug)
 			printf ("Called HelpSuccessorFlagged ([%p], [%p])\n", prev, del);
 
+		stats.Help ();
+
 		// Attempt to mark and physically delete del since prev is flagged
 		del->backlink.store(prev);
 
@@ -103,223 +231,558 @@ class FRList
 		HelpMarkedForDeletion (prev, del);
 	}
 
-	void TryMarkForDeletion (FRNode<T>* n)
+	void TryMarkForDeletion (Node* n)
 	{
-		if (FRL_DEBUG)
-			printf ("Called TryMarkForDeletion (data %d, addr[%p], next[%p], succ %d, del %d)\n",
-				n->data, n, n->next.GetReference(), n->next.IsSuccessorMarked(), n->next.IsMarkedForDeletion());
+		if (Policy::Debug)
+			printf ("Called TryMarkForDeletion (data %s, addr[%p], next[%p], succ %d, del %d)\n",
+				FRFormatKey (n->data).text, n, n->next.GetReference(), n->next.IsSuccessorMarked(), n->next.IsMarkedForDeletion());
 
+		Backoff backoff;
 		do
 		{
 			// We need the next FRNode so we can update the flag
-			FRNode<T>* next = n->next.GetReference ();
+			Node* next = n->next.GetReference ();
 
-			if (FRL_DEBUG)
+			if (Policy::Debug)
 				printf ("Trying to replace ([%p], %d, %d) with ([%p], %d, %d)\n",
 					next, next->next.IsSuccessorMarked(), next->next.IsMarkedForDeletion(), next, 0, 1);
 
 			// If our CAS fails due to n successor being marked for deletion, help it and try again
-			if (n->next.CompareAndSet (next, next, false, false, false, true))
-				if (n->next.IsSuccessorMarked())
-					HelpSuccessorFlagged (n, next);
+			if (!n->next.template CompareAndSet<Policy::Debug> (next, next, false, false, false, true))
+			{
+				stats.CasFailure ();
+				contention.CasFailure (n->data);
+
+				// Only the FRNode the flag was read with is being deleted
+				uintptr_t seen = n->next.Load ();
+				if (n->next.IsSuccessorMarked (seen) && !n->next.IsMarkedForDeletion (seen))
+					HelpSuccessorFlagged (n, n->next.GetReference (seen));
+				else
+					backoff.Pause ();
+			}
 		} while (!n->next.IsMarkedForDeletion ());
 
-		if (FRL_DEBUG)
-			printf ("Marked (data %d, [%p]) for deletion\n", n->data, n);
+		if (Policy::Debug)
+			printf ("Marked (data %s, [%p]) for deletion\n", FRFormatKey (n->data).text, n);
 	}
 
-	bool TryFlagSuccessor (FRNode<T>* _prev, FRNode<T>* _target)
+	// Returns the FRNode now flagged for target, or NULL if target left the list.
+	// flagged is only set when this call was the one to assert the flag.
+	Node* TryFlagSuccessor (Node* _prev, Node* _target, bool* flagged)
 	{
-		if (FRL_DEBUG)
+		if (Policy::Debug)
 			printf ("Called TryFlagSuccessor (prev[%p], target[%p])\n", _prev, _target);
 
-		FRNode<T>* prev = _prev;
-		FRNode<T>* target = _target;
+		Node* prev = _prev;
+		Node* target = _target;
+		Backoff backoff;
+		*flagged = false;
 		while (true)
 		{
-			if (prev->next.IsSuccessorMarked())// If the FRNode already has successor flag
+			uintptr_t seen = prev->next.Load ();
+			if (prev->next.IsSuccessorMarked (seen) && prev->next.GetReference (seen) == target)// If another thread already flagged target
 			{
-				if (FRL_DEBUG)
+				if (Policy::Debug)
 					printf ("Target FRNode already had successor flag\n");
-				return false;
+				return prev;
 			}
 
-			if (prev->next.CompareAndSet(target, target, false, true, false, false))// Attempt to assert the successor flag
+			if (prev->next.template CompareAndSet<Policy::Debug> (target, target, false, true, false, false))// Attempt to assert the successor flag
 			{
-				if (FRL_DEBUG)
+				if (Policy::Debug)
 					printf ("Was able to set successor flag on prev FRNode [%p] for target [%p]\n", prev, target);
-				return true;// We were successful
+				*flagged = true;
+				return prev;// We were successful
+			}
+
+			stats.CasFailure ();
+			contention.CasFailure (target->data);
+
+			// Weak CAS can fail spuriously, retry before searching again
+			seen = prev->next.Load ();
+			if (!prev->next.IsSuccessorMarked (seen) && !prev->next.IsMarkedForDeletion (seen) && prev->next.GetReference (seen) == target)
+			{
+				backoff.Pause ();
+				continue;
 			}
 
 			while (prev->next.IsMarkedForDeletion ())// If the CAS failed because previous FRNode is marked for deletion
 			{
-				if (FRL_DEBUG)
+				if (Policy::Debug)
 					printf ("CAS failed because prev was marked for deletion, backtracking\n");
+				stats.Backtrack ();
 				prev = prev->backlink;// Go back up the chain one step
 			}
 
 			// Try to reaquire FRNodes if something moved
-			Window<T> w = SearchFrom(target->data, prev);
+			Window<T, Addressing> w = SearchFrom(Traits::Before (target->data), prev);
 
-			if (FRL_DEBUG)
+			if (Policy::Debug)
 			{
 				PrintList ();
 				printf ("Got window:\n");
-				printf ("\tpred (data %d, addr[%p], next[%p], succ %d, mark %d)\n",
-					w.pred->data, w.pred, w.pred->next.GetReference(), w.pred->next.IsSuccessorMarked(), w.pred->next.IsMarkedForDeletion());
-				printf ("\tcurr (data %d, addr[%p], next[%p], succ %d, mark %d)\n",
-					w.curr->data, w.curr, w.curr->next.GetReference(), w.curr->next.IsSuccessorMarked(), w.curr->next.IsMarkedForDeletion());
+				printf ("\tpred (data %s, addr[%p], next[%p], succ %d, mark %d)\n",
+					FRFormatKey (w.pred->data).text, w.pred, w.pred->next.GetReference(), w.pred->next.IsSuccessorMarked(), w.pred->next.IsMarkedForDeletion());
+				printf ("\tcurr (data %s, addr[%p], next[%p], succ %d, mark %d)\n",
+					FRFormatKey (w.curr->data).text, w.curr, w.curr->next.GetReference(), w.curr->next.IsSuccessorMarked(), w.curr->next.IsMarkedForDeletion());
 			}
 
 			prev = w.pred;
 
 			if (w.curr != target)// We didn't find our FRNode
 			{
-				if (FRL_DEBUG)
+				if (Policy::Debug)
 					printf ("Lost target FRNode after backtracking, maybe another FRNode removed it\n");
-				return false;
+				return NULL;
 			}
 		}
 	}
 
-	public:
-		FRList ()
+	// Inserts n searching from start, *cursor is left at n's predecessor
+	void AddFrom (Node* n, Node* start, Node** cursor)
+	{
+		if (Policy::Debug)
+			printf ("Called AddFrom (data %s, addr [%p], start [%p])\n", FRFormatKey (n->data).text, n, start);
+
+		Backoff backoff;
+		Node* prev;
+		Node* next;
+
+		// Look for the placement of our new FRNode
+		Window<T, Addressing> w = SearchFrom (n->data, start);
+		prev = w.pred;
+		next = w.curr;
+
+		if (Policy::Debug)
+		{
+			PrintList ();
+			printf ("Got window:\n");
+			printf ("\tpred (data %s, addr[%p], next[%p], succ %d, mark %d)\n",
+				FRFormatKey (w.pred->data).text, w.pred, w.pred->next.GetReference(), w.pred->next.IsSuccessorMarked(), w.pred->next.IsMarkedForDeletion());
+			printf ("\tcurr (data %s, addr[%p], next[%p], succ %d, mark %d)\n",
+				FRFormatKey (w.curr->data).text, w.curr, w.curr->next.GetReference(), w.curr->next.IsSuccessorMarked(), w.curr->next.IsMarkedForDeletion());
+		}
+
+		// If we find that FRNode already in the list, return
+		if (Equal (prev->data, n->data))
 		{
-			head = new FRNode<T> (INT_MIN);
-			tail = new FRNode<T> (INT_MAX);
-			head->next.Set(tail, false, false);
-			tail->next.Set(NULL, false, false);
+			if (Policy::Debug)
+				printf ("Cannot insert %s into list because it already exists\n", FRFormatKey (n->data).text);
+			*cursor = prev;
+			return;
+		}
 
-			if (FRL_DEBUG)
+		while (true)
+		{
+			// Flag and successor have to come from the same load, or we could help the wrong FRNode
+			uintptr_t seen = prev->next.Load ();
+			if (prev->next.IsSuccessorMarked (seen))// If pred is flagged, help
 			{
-				printf ("Just created list\n");
-				PrintList ();
+				HelpSuccessorFlagged (prev, prev->next.GetReference (seen));
+			} else {
+				// Set the next pointer for the new FRNode to the next FRNode in the list
+				n->next.template Set<Policy::Debug> (next, false, false);
+				
+				// Point prev to our new FRNode instead of next
+				if (prev->next.template CompareAndSet<Policy::Debug> (next, n, false, false, false, false))
+				{
+					if (Policy::Debug)
+					{
+						printf ("Successfully added FRNode (data %s, [%p]) into the list\n", FRFormatKey (n->data).text, n);
+						PrintList ();
+					}
+					*cursor = prev;
+					return;
+				} else {
+					stats.CasFailure ();
+					contention.CasFailure (n->data);
+					backoff.Pause ();
+
+					seen = prev->next.Load ();
+					if (prev->next.IsSuccessorMarked (seen))// If we failed becuase prev's successor is flagged
+						HelpSuccessorFlagged (prev, prev->next.GetReference (seen));
+					
+					while (prev->next.IsMarkedForDeletion())// If we failed becuase prev is marked
+					{
+						stats.Backtrack ();
+						prev = prev->backlink;
+					}
+				}
+			}
+
+			// Find our placement again from wherever we ended up
+			Window<T, Addressing> retry = SearchFrom (n->data, prev);
+			prev = retry.pred;
+			next = retry.curr;
+
+			if (Equal (prev->data, n->data))
+			{
+				if (Policy::Debug)
+					printf ("Cannot insert %s into list because another thread inserted it\n", FRFormatKey (n->data).text);
+				*cursor = prev;
+				return;
 			}
 		}
+	}
+
+	// Start must not be after Traits::Before (data)
+	Node* RemoveFrom (T data, Node* start, Node** cursor)
+	{
+		if (Policy::Debug)
+			printf ("Called RemoveFrom (%s, [%p])\n", FRFormatKey (data).text, start);
 
-		void Add (FRNode<T>* n)
+		// Find FRNode we are looking to delete
+		Window<T, Addressing> w = SearchFrom (Traits::Before (data), start);// Search for (prev, target) by undershooting
+		*cursor = w.pred;
+
+		if (Policy::Debug)
 		{
-			if (FRL_DEBUG)
-				printf ("Called Add (data %d, addr [%p])\n", n->data, n);
+			PrintList ();
+			printf ("Got window:\n");
+			printf ("\tpred (data %s, addr[%p], next[%p], succ %d, mark %d)\n",
+				FRFormatKey (w.pred->data).text, w.pred, w.pred->next.GetReference(), w.pred->next.IsSuccessorMarked(), w.pred->next.IsMarkedForDeletion());
+			printf ("\tcurr (data %s, addr[%p], next[%p], succ %d, mark %d)\n",
+				FRFormatKey (w.curr->data).text, w.curr, w.curr->next.GetReference(), w.curr->next.IsSuccessorMarked(), w.curr->next.IsMarkedForDeletion());
+		}
 
-			FRNode<T>* prev;
-			FRNode<T>* next;
+		if (!Equal (w.curr->data, data))// FRNode was not found in list
+		{
+			if (Policy::Debug)
+				printf ("Couldn't find %s in list to remove\n", FRFormatKey (data).text);
+			return NULL;
+		}
 
-			// Look for the placement of our new FRNode
-			Window<T> w = SearchFrom (n->data, head);
-			prev = w.pred;
-			next = w.curr;
+		bool result;
+		Node* prev = TryFlagSuccessor (w.pred, w.curr, &result);
+
+		if (prev != NULL)
+		{
+			HelpSuccessorFlagged (prev, w.curr);
+			*cursor = prev;
+		}
+		
+		if (!result)
+		{
+			if (Policy::Debug)
+				printf ("Couldn't flag successor so not removing anything\n");
+			return NULL;
+		}
+
+		if (Policy::Debug)
+			printf ("Successfully removed (data %s, [%p])\n", FRFormatKey (w.curr->data).text, w.curr);
+
+		return w.curr;
+	}
+
+	bool ContainsFrom (T data, Node* start, Node** cursor)
+	{
+		if (Policy::Debug)
+			printf ("Called ContainsFrom (%s, [%p])\n", FRFormatKey (data).text, start);
+
+		Window<T, Addressing> w = SearchFrom (data, start);
+		*cursor = w.pred;
+
+		if (Policy::Debug)
+		{
+			PrintList ();
+			printf ("Got window:\n");
+			printf ("\tpred (data %s, addr[%p], next[%p], succ %d, mark %d)\n",
+				FRFormatKey (w.pred->data).text, w.pred, w.pred->next.GetReference(), w.pred->next.IsSuccessorMarked(), w.pred->next.IsMarkedForDeletion());
+			printf ("\tcurr (data %s, addr[%p], next[%p], succ %d, mark %d)\n",
+				FRFormatKey (w.curr->data).text, w.curr, w.curr->next.GetReference(), w.curr->next.IsSuccessorMarked(), w.curr->next.IsMarkedForDeletion());
+		}
+
+		return Equal (w.pred->data, data);
+	}
+
+	typedef std::integral_constant<bool, Contention::Enabled> ContentionEnabled;
+	typedef FRCombiningRequest<T, Addressing> Request;
 
-			if (FRL_DEBUG)
+	static bool RequestLess (const Request* a, const Request* b)
+	{
+		return Traits::Less (a->key, b->key);
+	}
+
+	// Continue a batch from the last window if it is still live and not past key
+	Node* StartFrom (Node* cursor, T key)
+	{
+		while (cursor != NULL && cursor->next.IsMarkedForDeletion ())
+		{
+			stats.Backtrack ();
+			cursor = cursor->backlink;
+		}
+
+		if (cursor == NULL || cursor == head || !LessOrEqual (cursor->data, key))
+			return SearchStart (key);
+
+		return cursor;
+	}
+
+	// Runs a batch in key order so the whole batch is a single traversal
+	void ApplyBatch (Request** batch, int count)
+	{
+		std::sort (batch, batch + count, RequestLess);
+
+		Node* cursor = head;
+		for (int i = 0; i < count; i++)
+		{
+			Request* r = batch[i];
+			if (r->op == FR_ADD)
+				AddFrom (r->node, StartFrom (cursor, r->key), &cursor);
+			else if (r->op == FR_REMOVE)
+				r->node = RemoveFrom (r->key, StartFrom (cursor, Traits::Before (r->key)), &cursor);
+			else
+				r->found = ContainsFrom (r->key, StartFrom (cursor, r->key), &cursor);
+		}
+
+		if (Policy::Debug)
+			printf ("Combined a batch of %d operations\n", count);
+	}
+
+	// Contention management disabled, always run the operation directly
+	bool Combine (FROperation, T, Node*, Node**, bool*, std::false_type)
+	{
+		return false;
+	}
+
+	// Returns false if the operation should run directly instead
+	bool Combine (FROperation op, T key, Node* node, Node** removed, bool* found, std::true_type)
+	{
+		if (!contention.IsHot (key))
+			return false;
+
+		Request* r = contention.Publish (op, key, node);
+		if (r == NULL)
+			return false;
+
+		// Wait for a combiner to take our request, or become the combiner
+		Request* batch [Contention::SLOTS];
+		while (!contention.IsDone (r))
+		{
+			if (contention.TryLock (key))
 			{
-				PrintList ();
-				printf ("Got window:\n");
-				printf ("\tpred (data %d, addr[%p], next[%p], succ %d, mark %d)\n",
-					w.pred->data, w.pred, w.pred->next.GetReference(), w.pred->next.IsSuccessorMarked(), w.pred->next.IsMarkedForDeletion());
-				printf ("\tcurr (data %d, addr[%p], next[%p], succ %d, mark %d)\n",
-					w.curr->data, w.curr, w.curr->next.GetReference(), w.curr->next.IsSuccessorMarked(), w.curr->next.IsMarkedForDeletion());
+				int count = contention.Collect (key, batch);
+				ApplyBatch (batch, count);
+				contention.Finish (key, batch, count);
+				contention.Unlock (key);
 			}
+			else
+				std::this_thread::yield ();
+		}
 
-			// If we find that FRNode already in the list, return
-			if (prev->data == n->data)
+		*removed = r->node;
+		*found = r->found;
+		contention.Release (r);
+		return true;
+	}
+
+	public:
+		FRList ()
+		{
+			head = Allocator::Allocate (Traits::Min ());
+			tail = Allocator::Allocate (Traits::Max ());
+			ownsSentinels = true;
+			head->next.template Set<Policy::Debug> (tail, false, false);
+			tail->next.template Set<Policy::Debug> (NULL, false, false);
+			head->backlink.store(NULL);
+			tail->backlink.store(NULL);
+
+			index.store (NULL);
+			indexEpoch.store (0);
+			for (int i = 0; i < INDEX_READER_SHARDS; i++)
 			{
-				if (FRL_DEBUG)
-					printf ("Cannot insert %d into list because it already exists\n", n->data);
-				return;
+				indexReaders[0][i].count.store (0);
+				indexReaders[1][i].count.store (0);
 			}
+			indexRunning.store (false);
+			indexRebuilding.store (false);
 
-			while (true)
+			if (Policy::Debug)
 			{
-				if (prev->next.GetReference()->next.IsSuccessorMarked())// If pred is flagged, help
-				{
-					HelpSuccessorFlagged (prev, prev->next.GetReference());
-				} else {
-					// Set the next pointer for the new FRNode to the next FRNode in the list
-					n->next.Set(next, false, false);
-					
-					// Point prev to our new FRNode instead of next
-					if (prev->next.CompareAndSet(next, n, false, false, false, false))
-					{
-						if (FRL_DEBUG)
-						{
-							printf ("Successfully added FRNode (data %d, [%p]) into the list\n", n->data, n);
-							PrintList ();
-						}
-						return;
-					} else {
-						if (prev->next.IsSuccessorMarked())// If we failed becuase prev's successor is flagged
-							HelpSuccessorFlagged (prev, prev->next.GetReference());
-						
-						while (prev->next.IsMarkedForDeletion())// If we failed becuase prev is marked
-							prev = prev->backlink;
-					}
-
-				
-				}
+				printf ("Just created list\n");
+				PrintList ();
 			}
 		}
 
-		FRNode<T>* Remove (T data)
+		// Attach to sentinels that are already linked, such as ones in shared memory
+		FRList (Node* _head, Node* _tail)
 		{
-			if (FRL_DEBUG)
-				printf ("Called Remove(%d)\n", data);
-			
-			// Find FRNode we are looking to delete
-			Window<T> w = SearchFrom (data - EPSILON, head);// Search for (prev, target) by undershooting
+			head = _head;
+			tail = _tail;
+			ownsSentinels = false;
 
-			if (FRL_DEBUG)
+			index.store (NULL);
+			indexEpoch.store (0);
+			for (int i = 0; i < INDEX_READER_SHARDS; i++)
 			{
-				PrintList ();
-				printf ("Got window:\n");
-				printf ("\tpred (data %d, addr[%p], next[%p], succ %d, mark %d)\n",
-					w.pred->data, w.pred, w.pred->next.GetReference(), w.pred->next.IsSuccessorMarked(), w.pred->next.IsMarkedForDeletion());
-				printf ("\tcurr (data %d, addr[%p], next[%p], succ %d, mark %d)\n",
-					w.curr->data, w.curr, w.curr->next.GetReference(), w.curr->next.IsSuccessorMarked(), w.curr->next.IsMarkedForDeletion());
+				indexReaders[0][i].count.store (0);
+				indexReaders[1][i].count.store (0);
 			}
+			indexRunning.store (false);
+			indexRebuilding.store (false);
+		}
+
+		// FRNodes that were added stay with the caller, only owned sentinels are freed
+		~FRList ()
+		{
+			StopIndexMaintenance ();
 
-			if (w.curr->data != data)// FRNode was not found in list
+			if (ownsSentinels)
 			{
-				if (FRL_DEBUG)
-					printf ("Couldn't find %d in list to remove\n", data);
-				return NULL;
+				Allocator::Free (head);
+				Allocator::Free (tail);
 			}
+		}
 
-			bool result = TryFlagSuccessor (w.pred, w.curr);
+		// Keys equal to a sentinel are ignored
+		void Add (Node* n)
+		{
+			FRReclaimerGuard<Reclaimer> guard;
+			Node* removed;
+			bool found;
+			Node* cursor;
 
-			if (w.pred != NULL)
-				HelpSuccessorFlagged (w.pred, w.curr);
-			
-			if (!result)
+			if (!InRange (n->data))
 			{
-				if (FRL_DEBUG)
-					printf ("Couldn't flag successor so not removing anything\n");
-				return NULL;
+				if (Policy::Debug)
+					printf ("Add ignored a key equal to a sentinel\n");
+				return;
 			}
 
-			if (FRL_DEBUG)
-				printf ("Successfully removed (data %d, [%p])\n", w.curr->data, w.curr);
+			if (Combine (FR_ADD, n->data, n, &removed, &found, ContentionEnabled ()))
+				return;
 
-			return w.curr;
+			AddFrom (n, SearchStart (n->data), &cursor);
+		}
+
+		Node* Remove (T data)
+		{
+			FRReclaimerGuard<Reclaimer> guard;
+			Node* removed;
+			bool found;
+			Node* cursor;
+
+			if (!InRange (data))
+				return NULL;
+
+			if (Combine (FR_REMOVE, data, NULL, &removed, &found, ContentionEnabled ()))
+				return removed;
+
+			removed = RemoveFrom (data, SearchStart (Traits::Before (data)), &cursor);
+			return removed;
 		}
 
 		bool Contains (T data)
 		{
-			if (FRL_DEBUG)
-				printf ("Called Contains (%d)\n", data);
+			FRReclaimerGuard<Reclaimer> guard;
+			Node* removed;
+			bool found;
+			Node* cursor;
 
-			Window<T> w = SearchFrom (data, head);
+			if (!InRange (data))
+				return false;
+
+			if (Combine (FR_CONTAINS, data, NULL, &removed, &found, ContentionEnabled ()))
+				return found;
+
+			found = ContainsFrom (data, SearchStart (data), &cursor);
+			return found;
+		}
+
+		// Hands an FRNode returned by Remove to the reclamation policy
+		void Retire (Node* n)
+		{
+			Reclaimer::Retire (n);
+		}
 
-			if (FRL_DEBUG)
+		Node* GetHead ()
+		{
+			return head;
+		}
+
+		Node* GetTail ()
+		{
+			return tail;
+		}
+
+		Stats& GetStats ()
+		{
+			return stats;
+		}
+
+		Contention& GetContention ()
+		{
+			return contention;
+		}
+
+		// Samples every stride-th live FRNode into a new index and swaps it in.
+		// Removed FRNodes must stay allocated while an index is in use since
+		// shortcuts and their backlinks may still point at them.
+		void RebuildIndex (int stride)
+		{
+			static_assert (!Reclaimer::FreesNodes, "The sparse index holds FRNode pointers across operations and cannot be used with a reclaimer that frees them");
+
+			// Only one rebuild at a time, a concurrent caller just skips
+			if (indexRebuilding.exchange (true))
+				return;
+
+			FRReclaimerGuard<Reclaimer> guard;
+			SparseIndex<T, Traits, Addressing>* fresh = new SparseIndex<T, Traits, Addressing> ();
+
+			int sinceLast = 0;
+			Node* curr = head->next.GetReference ();
+			while (curr != tail)
 			{
-				PrintList ();
-				printf ("Got window:\n");
-				printf ("\tpred (data %d, addr[%p], next[%p], succ %d, mark %d)\n",
-					w.pred->data, w.pred, w.pred->next.GetReference(), w.pred->next.IsSuccessorMarked(), w.pred->next.IsMarkedForDeletion());
-				printf ("\tcurr (data %d, addr[%p], next[%p], succ %d, mark %d)\n",
-					w.curr->data, w.curr, w.curr->next.GetReference(), w.curr->next.IsSuccessorMarked(), w.curr->next.IsMarkedForDeletion());
+				if (!curr->next.IsMarkedForDeletion () && ++sinceLast >= stride)
+				{
+					fresh->Append (curr->data, curr);
+					sinceLast = 0;
+				}
+				curr = curr->next.GetReference ();
+			}
+
+			SparseIndex<T, Traits, Addressing>* old = index.exchange (fresh);
+			if (old != NULL)
+				ReclaimIndex (old);
+
+			if (Policy::Debug)
+				printf ("Rebuilt index with %lu shortcuts\n", (unsigned long)fresh->keys.size ());
+
+			indexRebuilding.store (false);
+		}
+
+		// Starts a thread that rebuilds the index every intervalMs milliseconds
+		bool StartIndexMaintenance (int stride, unsigned int intervalMs)
+		{
+			if (stride < 1 || indexRunning.exchange (true))
+				return false;
+
+			indexStride = stride;
+			indexIntervalMs = intervalMs;
+
+			if (pthread_create (&indexThread, NULL, IndexThreadLogic, (void*)this) != 0)
+			{
+				indexRunning.store (false);
+				return false;
 			}
 
-			return (w.pred->data == data);
+			return true;
+		}
+
+		// Stops the maintenance thread and goes back to searching from head
+		void StopIndexMaintenance ()
+		{
+			if (indexRunning.exchange (false))
+				pthread_join (indexThread, NULL);
+
+			while (indexRebuilding.exchange (true))
+				;
+
+			SparseIndex<T, Traits, Addressing>* old = index.exchange (NULL);
+			if (old != NULL)
+				ReclaimIndex (old);
+
+			indexRebuilding.store (false);
 		}
 };
 
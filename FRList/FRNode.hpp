@@ -1,19 +1,20 @@
 #ifndef FRNode_H
 #define FRNode_H
 
+#include "FRAddressing.hpp"
 #include "MarkableReference.hpp"
 
 // Forward declaration required to avoid circular dependency
-template <class T>
+template <class T, class Addressing>
 class MarkableReference;
 
-template <class T>
+template <class T, class Addressing>
 class FRNode
 {
 	public:
 		T data;
-		std::atomic<FRNode<T>*> backlink;
-		MarkableReference<T> next;
+		AtomicLink<FRNode<T, Addressing>, Addressing> backlink;
+		MarkableReference<T, Addressing> next;
 
 		FRNode () {}
 
@@ -0,0 +1,204 @@
+#ifndef FR_POLICY_H
+#define FR_POLICY_H
+
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+#include <stddef.h>
+#include <stdio.h>
+#include "FRAddressing.hpp"
+#include "FRNode.hpp"
+#include "FlatCombiner.hpp"
+
+/*
+ * Compile time configuration for FRList. A custom policy only needs to
+ * override what it changes, for example:
+ *
+ *	struct BackoffPolicy : FRDefaultPolicy<int>
+ *	{
+ *		typedef FRExponentialBackoff Backoff;
+ *	};
+ *
+ *	FRList<int, BackoffPolicy> list;
+ */
+
+// Sentinel values and ordering of keys. Min and Max belong to the sentinels,
+// so FRList only stores keys strictly between them.
+template <class T>
+struct FRKeyTraits
+{
+	static_assert (std::is_arithmetic<T>::value, "FRKeyTraits needs an arithmetic key, write custom traits for other types");
+
+	static T Min () { return std::numeric_limits<T>::lowest (); }
+	static T Max () { return std::numeric_limits<T>::max (); }
+
+	static bool Less (T a, T b) { return a < b; }
+
+	// Key just before k, Remove searches for it to land on the FRNode before k.
+	// Only called for keys above Min, so unsigned keys never wrap.
+	static T Before (T k) { return Before (k, std::is_floating_point<T> ()); }
+
+	private:
+		static T Before (T k, std::true_type) { return std::nextafter (k, Min ()); }
+		static T Before (T k, std::false_type) { return k - 1; }
+};
+
+// Text of a key for debug printing, printed with %s so the format does not
+// depend on T. Overload FRFormatKey for a key type to print it differently.
+struct FRKeyText
+{
+	char text [32];
+};
+
+template <class T>
+FRKeyText FRFormatKey (T key, std::true_type, std::false_type)// Floating point
+{
+	FRKeyText k;
+	snprintf (k.text, sizeof (k.text), "%g", (double)key);
+	return k;
+}
+
+template <class T>
+FRKeyText FRFormatKey (T key, std::false_type, std::true_type)// Integral
+{
+	FRKeyText k;
+	if (std::is_signed<T>::value)
+		snprintf (k.text, sizeof (k.text), "%lld", (long long)key);
+	else
+		snprintf (k.text, sizeof (k.text), "%llu", (unsigned long long)key);
+	return k;
+}
+
+template <class T>
+FRKeyText FRFormatKey (T, std::false_type, std::false_type)
+{
+	FRKeyText k;
+	snprintf (k.text, sizeof (k.text), "?");
+	return k;
+}
+
+template <class T>
+FRKeyText FRFormatKey (T key)
+{
+	return FRFormatKey (key, std::is_floating_point<T> (), std::is_integral<T> ());
+}
+
+// Allocates sentinels and snapshot FRNodes with new, callers free what they get back
+template <class T>
+struct FRNewAllocator
+{
+	typedef FRNode<T> Node;
+
+	static Node* Allocate (T data) { return new Node (data); }
+	static void Free (Node* node) { delete node; }
+	static Node* AllocateArray (size_t count) { return new Node [count]; }
+	static void FreeArray (Node* nodes) { delete [] nodes; }
+};
+
+/*
+ * Reclaimers decide when a Retired FRNode may be freed. Enter and Leave
+ * bracket every operation and every walk over the list, including
+ * RebuildIndex and SaveSnapshot, and a reclaimer may only free an FRNode
+ * once every thread that was inside when it was retired has left.
+ *
+ * The sparse index keeps FRNode pointers between operations, outside any
+ * Enter/Leave pair, so it only works with reclaimers that never free. A
+ * reclaimer sets FreesNodes to true if it does, and FRList then refuses to
+ * build an index at compile time.
+ */
+
+// Leaves removed FRNodes to the caller
+struct FRNoReclaimer
+{
+	static const bool FreesNodes = false;
+
+	static void Enter () {}
+	static void Leave () {}
+
+	template <class N>
+	static void Retire (N*) {}
+};
+
+// Scoped Enter/Leave for one list operation
+template <class Reclaimer>
+struct FRReclaimerGuard
+{
+	FRReclaimerGuard () { Reclaimer::Enter (); }
+	~FRReclaimerGuard () { Reclaimer::Leave (); }
+};
+
+// Retries failed CAS immediately
+struct FRNoBackoff
+{
+	void Pause () {}
+};
+
+// Spins for twice as long after each failed CAS in an operation, up to a cap
+struct FRExponentialBackoff
+{
+	static const int MIN_SPINS = 4;
+	static const int MAX_SPINS = 1024;
+
+	int spins;
+
+	FRExponentialBackoff ()
+	{
+		spins = MIN_SPINS;
+	}
+
+	void Pause ()
+	{
+		for (int i = 0; i < spins; i++)
+			std::atomic_signal_fence (std::memory_order_seq_cst);
+
+		if (spins < MAX_SPINS)
+			spins *= 2;
+	}
+};
+
+// Contention management policies, FRNoContention and FRFlatCombining, are in FlatCombiner.hpp
+
+// Discards all statistics
+struct FRNoStats
+{
+	void CasFailure () {}
+	void Help () {}
+	void Backtrack () {}
+};
+
+// Counts contention events across all threads
+struct FRCountingStats
+{
+	std::atomic<unsigned long> casFailures;
+	std::atomic<unsigned long> helps;
+	std::atomic<unsigned long> backtracks;
+
+	FRCountingStats ()
+	{
+		casFailures.store (0);
+		helps.store (0);
+		backtracks.store (0);
+	}
+
+	void CasFailure () { casFailures.fetch_add (1, std::memory_order_relaxed); }
+	void Help () { helps.fetch_add (1, std::memory_order_relaxed); }
+	void Backtrack () { backtracks.fetch_add (1, std::memory_order_relaxed); }
+};
+
+template <class T>
+struct FRDefaultPolicy
+{
+	typedef FRKeyTraits<T> Traits;
+	typedef FRRawAddressing Addressing;
+	typedef FRNewAllocator<T> Allocator;
+	typedef FRNoReclaimer Reclaimer;
+	typedef FRNoBackoff Backoff;
+	typedef FRNoStats Stats;
+	typedef FRNoContention Contention;
+
+	// Toggle for debug printing
+	static const bool Debug = false;
+};
+
+#endif
@@ -0,0 +1,230 @@
+#ifndef FR_SNAPSHOT_H
+#define FR_SNAPSHOT_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <type_traits>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "FRList.hpp"
+
+// Snapshot files start with this header followed by count keys in ascending order
+#define SNAPSHOT_MAGIC "FRSNAP1"
+#define SNAPSHOT_BUFFER_KEYS 4096
+
+struct SnapshotHeader
+{
+	char magic[8];
+	uint32_t keySize;
+	uint32_t complete;// Only set once every key has been written
+	uint64_t count;
+};
+
+// Flushes the directory holding path so a rename into it survives a crash
+inline bool SyncDirectory (const char* path)
+{
+	std::string directory (path);
+	size_t slash = directory.rfind ('/');
+	if (slash == std::string::npos)
+		directory = ".";
+	else if (slash == 0)
+		directory = "/";
+	else
+		directory.resize (slash);
+
+	int fd = open (directory.c_str (), O_RDONLY | O_DIRECTORY);
+	if (fd < 0)
+		return false;
+
+	bool ok = fsync (fd) == 0;
+	close (fd);
+	return ok;
+}
+
+// Writes the keys of every unmarked FRNode to path in ascending order.
+// Safe to call while other threads modify the list, keys added or removed
+// during the save may or may not be included. The file is written next to
+// path and renamed over it, so a failed save leaves the old snapshot intact.
+// Both the file and its directory are fsynced before SaveSnapshot returns.
+template <class List>
+bool SaveSnapshot (List& list, const char* path)
+{
+	typedef typename List::Node Node;
+	typedef typename List::Key T;
+	static_assert (std::is_trivially_copyable<T>::value, "Snapshots require a trivially copyable key type");
+
+	if (List::Debug)
+		printf ("Called SaveSnapshot (%s)\n", path);
+
+	std::string tempPath = std::string (path) + ".tmp";
+	FILE* file = fopen (tempPath.c_str (), "wb");
+	if (file == NULL)
+		return false;
+
+	// Count is not known until the traversal finishes, so patch it in afterwards
+	SnapshotHeader header;
+	memset (&header, 0, sizeof (header));
+	memcpy (header.magic, SNAPSHOT_MAGIC, sizeof (header.magic));
+	header.keySize = sizeof (T);
+	bool ok = fwrite (&header, sizeof (header), 1, file) == 1;
+
+	T buffer [SNAPSHOT_BUFFER_KEYS];
+	size_t buffered = 0;
+
+	// Keys only ever increase along next pointers, even through marked FRNodes
+	{
+		FRReclaimerGuard<typename List::Reclaimer> guard;
+		Node* tail = list.GetTail ();
+		Node* curr = list.GetHead ()->next.GetReference ();
+		while (ok && curr != tail)
+		{
+			if (!curr->next.IsMarkedForDeletion ())
+			{
+				buffer[buffered++] = curr->data;
+				header.count++;
+
+				if (buffered == SNAPSHOT_BUFFER_KEYS)
+				{
+					ok = fwrite (buffer, sizeof (T), buffered, file) == buffered;
+					buffered = 0;
+				}
+			}
+			curr = curr->next.GetReference ();
+		}
+	}
+
+	if (ok && buffered > 0)
+		ok = fwrite (buffer, sizeof (T), buffered, file) == buffered;
+
+	header.complete = 1;
+	if (ok)
+		ok = fseek (file, 0, SEEK_SET) == 0 && fwrite (&header, sizeof (header), 1, file) == 1;
+
+	// Make sure the data is on disk before it replaces the previous snapshot
+	if (ok)
+		ok = fflush (file) == 0 && fsync (fileno (file)) == 0;
+
+	ok = (fclose (file) == 0) && ok;
+
+	if (ok)
+		ok = rename (tempPath.c_str (), path) == 0 && SyncDirectory (path);
+	else
+		remove (tempPath.c_str ());
+
+	if (List::Debug)
+		printf ("Saved %llu keys to %s (%s)\n", (unsigned long long)header.count, path, (ok ? "ok" : "failed"));
+
+	return ok;
+}
+
+// Links every key in a snapshot file into an empty list without searching.
+// On success *nodes holds the block of *count FRNodes backing the keys, which
+// the caller owns and releases with List::Allocator::FreeArray.
+template <class List>
+bool LoadSnapshot (List& list, const char* path, typename List::Node** nodes, size_t* count)
+{
+	typedef typename List::Node Node;
+	typedef typename List::Key T;
+	typedef typename List::Traits Traits;
+	static_assert (std::is_trivially_copyable<T>::value, "Snapshots require a trivially copyable key type");
+
+	if (List::Debug)
+		printf ("Called LoadSnapshot (%s)\n", path);
+
+	*nodes = NULL;
+	*count = 0;
+
+	// Bulk linking is only valid when nothing else is in the list
+	Node* head = list.GetHead ();
+	Node* tail = list.GetTail ();
+	uintptr_t seen = head->next.Load ();
+	if (head->next.GetReference (seen) != tail || head->next.IsSuccessorMarked (seen))
+	{
+		if (List::Debug)
+			printf ("Cannot load snapshot into a non-empty list\n");
+		return false;
+	}
+
+	int fd = open (path, O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat info;
+	if (fstat (fd, &info) != 0 || (size_t)info.st_size < sizeof (SnapshotHeader))
+	{
+		close (fd);
+		return false;
+	}
+
+	size_t length = (size_t)info.st_size;
+	void* mapped = mmap (NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+	close (fd);
+	if (mapped == MAP_FAILED)
+		return false;
+
+	madvise (mapped, length, MADV_SEQUENTIAL);
+
+	const SnapshotHeader* header = (const SnapshotHeader*)mapped;
+	const T* keys = (const T*)(header + 1);
+
+	// Reject anything that is not a complete snapshot of this key type
+	bool valid = memcmp (header->magic, SNAPSHOT_MAGIC, sizeof (header->magic)) == 0 &&
+		header->keySize == sizeof (T) &&
+		header->complete == 1 &&
+		header->count <= (length - sizeof (SnapshotHeader)) / sizeof (T) &&
+		length == sizeof (SnapshotHeader) + header->count * sizeof (T);
+
+	for (uint64_t i = 0; valid && i < header->count; i++)
+	{
+		T prev = (i == 0) ? head->data : keys[i - 1];
+		valid = Traits::Less (prev, keys[i]) && Traits::Less (keys[i], tail->data);
+	}
+
+	if (!valid || header->count == 0)
+	{
+		munmap (mapped, length);
+		return valid;
+	}
+
+	size_t loaded = (size_t)header->count;
+	Node* block = List::Allocator::AllocateArray (loaded);
+
+	// Link the FRNodes back to front so each one points at its successor
+	Node* next = tail;
+	for (size_t i = loaded; i-- > 0;)
+	{
+		block[i].data = keys[i];
+		block[i].backlink.store (NULL);
+		block[i].next.template Set<List::Debug> (next, false, false);
+		next = &block[i];
+	}
+
+	munmap (mapped, length);
+
+	// Publish the whole chain at once, fails if another thread added first
+	FRReclaimerGuard<typename List::Reclaimer> guard;
+	while (!head->next.template CompareAndSet<List::Debug> (tail, block, false, false, false, false))
+	{
+		seen = head->next.Load ();
+		if (head->next.GetReference (seen) != tail || head->next.IsSuccessorMarked (seen))
+		{
+			if (List::Debug)
+				printf ("List changed while loading snapshot, discarding\n");
+			List::Allocator::FreeArray (block);
+			return false;
+		}
+	}
+
+	if (List::Debug)
+		printf ("Loaded %lu keys from %s\n", (unsigned long)loaded, path);
+
+	*nodes = block;
+	*count = loaded;
+	return true;
+}
+
+#endif
@@ -0,0 +1,265 @@
+#ifndef FLAT_COMBINER_H
+#define FLAT_COMBINER_H
+
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <stdint.h>
+#include <type_traits>
+#include "FRAddressing.hpp"
+#include "FRNode.hpp"
+
+enum FROperation
+{
+	FR_ADD,
+	FR_REMOVE,
+	FR_CONTAINS
+};
+
+// Every operation runs lock-free on its own, the hooks compile away
+struct FRNoContention
+{
+	static const bool Enabled = false;
+
+	template <class T>
+	void CasFailure (T) {}
+};
+
+// An operation published for a combiner to run on the owner's behalf
+template <class T, class Addressing = FRRawAddressing>
+struct FRCombiningRequest
+{
+	std::atomic<int> state;
+	FROperation op;
+	T key;
+	FRNode<T, Addressing>* node;// FRNode to add, or the one that was removed
+	bool found;
+};
+
+/*
+ * Tracks CAS failures for blocks of 2^RegionShift neighbouring keys.
+ * Once failures pile up in a block its region turns hot and FRList routes
+ * the block's operations through the region's publication list, where
+ * whichever thread holds the region lock applies every pending request in
+ * one sorted pass. A hot region goes back to plain lock-free operation after
+ * COOL_BATCHES batches in a row find no other thread to combine with.
+ *
+ * Blocks map onto Regions like a direct mapped cache. A region remembers the
+ * block it is tracking and only that block is ever combined, another block
+ * has to wear the score down before it takes the region over. Scores halve
+ * every DECAY_PERIOD_US microseconds so only sustained failure makes a
+ * region hot. Keys must be integral, negative keys wrap around as unsigned.
+ */
+template <class T, class Addressing = FRRawAddressing, int RegionShift = 4, int Regions = 64, int Slots = 32>
+class FRFlatCombining
+{
+	static_assert (std::is_integral<T>::value, "FRFlatCombining maps keys to regions by their integer value, T must be integral");
+
+	public:
+		static const bool Enabled = true;
+		static const int SLOTS = Slots;
+		static const int HOT_THRESHOLD = 64;
+		static const int COOL_BATCHES = 32;
+		static const int DECAY_PERIOD_US = 1000;
+
+		enum
+		{
+			SLOT_EMPTY,// Free to claim
+			SLOT_CLAIMED,// Owner is filling in the request
+			SLOT_PENDING,// Waiting for a combiner
+			SLOT_COMBINING,// Collected into a batch
+			SLOT_DONE// Result ready for the owner
+		};
+
+		typedef FRCombiningRequest<T, Addressing> Request;
+
+	private:
+		// Every operation reads hot, so it gets a cache line to itself away
+		// from the fields CAS failures and combiners keep writing
+		struct alignas(64) Region
+		{
+			std::atomic<bool> hot;
+			alignas(64) std::atomic<int> score;
+			std::atomic<unsigned long long> block;// Block of keys this region tracks
+			std::atomic<unsigned int> decayPeriod;
+			std::atomic<bool> locked;
+			int quietBatches;// Only touched while holding locked
+			alignas(64) Request slots [Slots];
+		};
+
+		// new only guarantees 16 byte alignment before C++17, so the regions
+		// live in their own block aligned by hand
+		char* storage;
+		Region* regions;
+
+		static unsigned long long BlockOf (T key)
+		{
+			return (unsigned long long)key >> RegionShift;
+		}
+
+		Region& RegionOf (T key)
+		{
+			return regions[BlockOf (key) % Regions];
+		}
+
+		// Halves the score once for every period that passed since the last decay
+		void Decay (Region& region)
+		{
+			unsigned int now = (unsigned int)(std::chrono::duration_cast<std::chrono::microseconds> (
+				std::chrono::steady_clock::now ().time_since_epoch ()).count () / DECAY_PERIOD_US);
+			unsigned int last = region.decayPeriod.load (std::memory_order_relaxed);
+			if (now == last || !region.decayPeriod.compare_exchange_strong (last, now, std::memory_order_relaxed))
+				return;
+
+			unsigned int periods = now - last;
+			int score = region.score.load (std::memory_order_relaxed);
+			region.score.store ((periods >= 31) ? 0 : (score >> periods), std::memory_order_relaxed);
+		}
+
+	public:
+		FRFlatCombining ()
+		{
+			storage = new char [sizeof (Region) * Regions + alignof (Region)];
+			regions = (Region*)(((uintptr_t)storage + alignof (Region) - 1) & ~(uintptr_t)(alignof (Region) - 1));
+
+			for (int i = 0; i < Regions; i++)
+			{
+				new (&regions[i]) Region;
+				regions[i].hot.store (false);
+				regions[i].score.store (0);
+				regions[i].block.store (0);
+				regions[i].decayPeriod.store (0);
+				regions[i].locked.store (false);
+				regions[i].quietBatches = 0;
+
+				for (int j = 0; j < Slots; j++)
+					regions[i].slots[j].state.store (SLOT_EMPTY);
+			}
+		}
+
+		~FRFlatCombining ()
+		{
+			for (int i = 0; i < Regions; i++)
+				regions[i].~Region ();
+			delete [] storage;
+		}
+
+		FRFlatCombining (const FRFlatCombining&) = delete;
+		FRFlatCombining& operator= (const FRFlatCombining&) = delete;
+
+		bool IsHot (T key)
+		{
+			Region& region = RegionOf (key);
+			return region.hot.load (std::memory_order_relaxed) && region.block.load (std::memory_order_relaxed) == BlockOf (key);
+		}
+
+		void CasFailure (T key)
+		{
+			Region& region = RegionOf (key);
+			unsigned long long block = BlockOf (key);
+			Decay (region);
+
+			// Another block sharing the region counts against the current one until it takes over
+			if (region.block.load (std::memory_order_relaxed) != block)
+			{
+				if (region.hot.load (std::memory_order_relaxed))
+					return;
+
+				int score = region.score.load (std::memory_order_relaxed);
+				if (score > 0)
+				{
+					region.score.compare_exchange_weak (score, score - 1, std::memory_order_relaxed);
+					return;
+				}
+				region.block.store (block, std::memory_order_relaxed);
+			}
+
+			if (region.score.fetch_add (1, std::memory_order_relaxed) + 1 >= HOT_THRESHOLD &&
+				!region.hot.load (std::memory_order_relaxed))
+				region.hot.store (true);
+		}
+
+		// Returns NULL when every slot in the region is taken
+		Request* Publish (FROperation op, T key, FRNode<T, Addressing>* node)
+		{
+			static thread_local unsigned int hint = 0;
+			Region& region = RegionOf (key);
+
+			for (int i = 0; i < Slots; i++)
+			{
+				Request* r = &region.slots[(hint + i) % Slots];
+				int expected = SLOT_EMPTY;
+				if (r->state.load (std::memory_order_relaxed) == SLOT_EMPTY &&
+					r->state.compare_exchange_strong (expected, SLOT_CLAIMED))
+				{
+					hint = (hint + i) % Slots;
+					r->op = op;
+					r->key = key;
+					r->node = node;
+					r->found = false;
+					r->state.store (SLOT_PENDING, std::memory_order_release);
+					return r;
+				}
+			}
+
+			return NULL;
+		}
+
+		bool IsDone (Request* r)
+		{
+			return r->state.load (std::memory_order_acquire) == SLOT_DONE;
+		}
+
+		void Release (Request* r)
+		{
+			r->state.store (SLOT_EMPTY, std::memory_order_release);
+		}
+
+		bool TryLock (T key)
+		{
+			Region& region = RegionOf (key);
+			return !region.locked.load (std::memory_order_relaxed) && !region.locked.exchange (true, std::memory_order_acquire);
+		}
+
+		void Unlock (T key)
+		{
+			RegionOf (key).locked.store (false, std::memory_order_release);
+		}
+
+		// Claims every pending request in the region, batch must hold SLOTS entries
+		int Collect (T key, Request** batch)
+		{
+			Region& region = RegionOf (key);
+			int count = 0;
+
+			for (int i = 0; i < Slots; i++)
+			{
+				int expected = SLOT_PENDING;
+				if (region.slots[i].state.load (std::memory_order_acquire) == SLOT_PENDING &&
+					region.slots[i].state.compare_exchange_strong (expected, SLOT_COMBINING))
+					batch[count++] = &region.slots[i];
+			}
+
+			return count;
+		}
+
+		// Hands results back to their owners and cools the region if nobody else is around
+		void Finish (T key, Request** batch, int count)
+		{
+			Region& region = RegionOf (key);
+
+			for (int i = 0; i < count; i++)
+				batch[i]->state.store (SLOT_DONE, std::memory_order_release);
+
+			if (count > 1)
+				region.quietBatches = 0;
+			else if (++region.quietBatches >= COOL_BATCHES)
+			{
+				region.quietBatches = 0;
+				region.score.store (0, std::memory_order_relaxed);
+				region.hot.store (false);
+			}
+		}
+};
+
+#endif
@@ -1,9 +1,7 @@
 #ifndef MARKABLE_REFERENCE_H
 #define MARKABLE_REFERENCE_H
 
-// Toggle for debug printing
-#define MR_DEBUG_FLAG false
-
+#include "FRAddressing.hpp"
 #include "FRNode.hpp"
 #include <atomic>
 
@@ -15,88 +13,113 @@
 #define SUCCESSOR_BIT 0x02
 #define BOTH_BITS 0x03
 
-#define CAS(exp, succ) compare_exchange_weak(exp, succ)
-
 // Forward declaration required to avoid circular dependency
-template <class T>
+template <class T, class Addressing>
 class FRNode;
 
-template <class T>
+// The reference is stored through Addressing, an address or segment offset,
+// either way FRNodes are aligned so the low two bits are free for the flags.
+// Set and CompareAndSet take the owning list's Debug switch as a template argument.
+template <class T, class Addressing>
 class MarkableReference
 {
 	public:
-		std::atomic<FRNode<T>*> ptr;
+		std::atomic<uintptr_t> ptr;
 
 		MarkableReference () {}
 
-		MarkableReference (FRNode<T>* _ptr)
+		MarkableReference (FRNode<T, Addressing>* _ptr)
 		{
-			ptr.store(_ptr);
+			ptr.store(Addressing::Encode (_ptr));
+		}
+
+		// Each getter below does its own load. Decisions that depend on the
+		// reference and a flag together must Load once and decode that word.
+		uintptr_t Load ()
+		{
+			return ptr.load();
 		}
 
 		// So it points to a byte aligned address, we need to remove the last two bits
-		FRNode<T>* GetReference ()
+		static FRNode<T, Addressing>* GetReference (uintptr_t word)
+		{
+			return (FRNode<T, Addressing>*)Addressing::Decode (word & ~(uintptr_t)BOTH_BITS);
+		}
+
+		static bool IsMarkedForDeletion (uintptr_t word)
+		{
+			return word & MARKED_FOR_DELETION_BIT;
+		}
+
+		static bool IsSuccessorMarked (uintptr_t word)
+		{
+			return word & SUCCESSOR_BIT;
+		}
+
+		FRNode<T, Addressing>* GetReference ()
 		{
-			return (FRNode<T>*)((uintptr_t)(ptr.load()) & ~BOTH_BITS);
+			return GetReference (ptr.load());
 		}
 
 		bool IsMarkedForDeletion ()
 		{
-			return (uintptr_t)(ptr.load()) & MARKED_FOR_DELETION_BIT;
+			return IsMarkedForDeletion (ptr.load());
 		}
 
 		bool IsSuccessorMarked ()
 		{
-			return (uintptr_t)(ptr.load()) & SUCCESSOR_BIT;
+			return IsSuccessorMarked (ptr.load());
 		}
 
-		bool Set (FRNode<T>* n, bool successorMarked, bool deletionMark)
+		template <bool Debug = false>
+		void Set (FRNode<T, Addressing>* n, bool successorMarked, bool deletionMark)
 		{
-			if (MR_DEBUG_FLAG)
+			if (Debug)
 			{
 				printf ("Called MR.Set([%p], %s, %s)\n", n, (successorMarked ? "true" : "false"), (deletionMark ? "true" : "false"));
-				printf ("\tPointer [%p] | Successor Bit(%p) | Marked Bit (%p)\n", (uintptr_t)(n), ((successorMarked) ? SUCCESSOR_BIT : 0x0), ((deletionMark) ? MARKED_FOR_DELETION_BIT : 0x0));
+				printf ("\tPointer [%p] | Successor Bit(%#x) | Marked Bit (%#x)\n", (void*)(n), ((successorMarked) ? SUCCESSOR_BIT : 0x0), ((deletionMark) ? MARKED_FOR_DELETION_BIT : 0x0));
 			}
 
-			FRNode<T>* newValue = (FRNode<T>*)(
-				(uintptr_t)(n) |
+			uintptr_t newValue = (
+				Addressing::Encode (n) |
 				((successorMarked) ? SUCCESSOR_BIT : 0x0) |
 				((deletionMark) ? MARKED_FOR_DELETION_BIT : 0x0));
 
-			if (MR_DEBUG_FLAG)
-				printf ("\tSetting pointer to [%p]\n", newValue);
+			if (Debug)
+				printf ("\tSetting pointer to [%p]\n", (void*)newValue);
 
 			ptr.store (newValue);
 		}
 
-		bool CompareAndSet (FRNode<T>* expected, FRNode<T>* success, bool expectedSuccessor, bool successSuccessor,
+		template <bool Debug = false>
+		bool CompareAndSet (FRNode<T, Addressing>* expected, FRNode<T, Addressing>* success, bool expectedSuccessor, bool successSuccessor,
 							bool expectedDeletionMark, bool successDeletionMark)
 		{
-			if (MR_DEBUG_FLAG)
+			if (Debug)
 				printf ("Called MR.CAS(exp [%p], success [%p], expSuccesor %s, successSuccessor %s, expDel %s, successDel %s\n",
 					expected, success, (expectedSuccessor ? "true" : "false"), (successSuccessor ? "true" : "false"),
 					(expectedDeletionMark ? "true" : "false"), (successDeletionMark ? "true" : "false"));
 
 			// Need to apply the indicated flags for the CAS to work
-			FRNode<T>* modifiedExpected = (FRNode<T>*)(
-				(uintptr_t)(expected) |
+			uintptr_t modifiedExpected = (
+				Addressing::Encode (expected) |
 				((expectedSuccessor) ? SUCCESSOR_BIT : 0x0) |
 				((expectedDeletionMark) ? MARKED_FOR_DELETION_BIT : 0x0));
 
-			if (MR_DEBUG_FLAG)
-				printf ("\tExpected = [%p] | (%p) | (%p)\n",
-					(uintptr_t)(expected), ((expectedSuccessor) ? SUCCESSOR_BIT : 0x0), ((expectedDeletionMark) ? MARKED_FOR_DELETION_BIT : 0x0));
+			if (Debug)
+				printf ("\tExpected = [%p] | (%#x) | (%#x)\n",
+					(void*)(expected), ((expectedSuccessor) ? SUCCESSOR_BIT : 0x0), ((expectedDeletionMark) ? MARKED_FOR_DELETION_BIT : 0x0));
 
-			FRNode<T>* modifiedSuccess = (FRNode<T>*)(
-				(uintptr_t)(success) |
+			uintptr_t modifiedSuccess = (
+				Addressing::Encode (success) |
 				((successSuccessor) ? SUCCESSOR_BIT : 0x0) |
 				((successDeletionMark) ? MARKED_FOR_DELETION_BIT : 0x0));
 			
-			if (MR_DEBUG_FLAG)
-				printf ("\tSuccess = [%p] | (%p) | (%p)\n",
-					(uintptr_t)(success), ((successSuccessor) ? SUCCESSOR_BIT : 0x0), ((successDeletionMark) ? MARKED_FOR_DELETION_BIT : 0x0));
+			if (Debug)
+				printf ("\tSuccess = [%p] | (%#x) | (%#x)\n",
+					(void*)(success), ((successSuccessor) ? SUCCESSOR_BIT : 0x0), ((successDeletionMark) ? MARKED_FOR_DELETION_BIT : 0x0));
 
-			return ptr.CAS(modifiedExpected, modifiedSuccess);
+			return ptr.compare_exchange_weak (modifiedExpected, modifiedSuccess);
 		}
 };
 
@@ -0,0 +1,301 @@
+#ifndef SHARED_FRLIST_H
+#define SHARED_FRLIST_H
+
+#include <atomic>
+#include <new>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "FRAddressing.hpp"
+#include "FRPolicy.hpp"
+#include "FRList.hpp"
+
+#define SHARED_SEGMENT_MAGIC "FRSHM02"
+#define SHARED_SEGMENT_OPEN_TRIES 1000
+#define SHARED_FREE_OFFSET_BITS 40// Segments are limited to 2^40 bytes, the rest of freeNodes is an ABA tag
+#define SHARED_FREE_OFFSET_MASK ((1ULL << SHARED_FREE_OFFSET_BITS) - 1)
+
+// Lives at offset 0 of the segment, so no FRNode can ever be at offset 0 (NULL)
+struct SharedSegmentHeader
+{
+	char magic[8];
+	uint32_t keySize;// Layout of the FRNodes, Open rejects a segment made for another type
+	uint32_t nodeSize;
+	uint64_t size;
+	std::atomic<uint64_t> used;
+	std::atomic<uint64_t> freeNodes;// Tagged offset of the first freed FRNode, 0 if none
+	std::atomic<uint64_t> head;
+	std::atomic<uint64_t> tail;
+	std::atomic<uint32_t> ready;
+};
+
+// Atomics in the segment are shared between processes, which only works when they are lock-free
+static_assert (ATOMIC_LLONG_LOCK_FREE == 2, "SharedFRList needs lock-free 64 bit atomics");
+static_assert (ATOMIC_INT_LOCK_FREE == 2, "SharedFRList needs lock-free 32 bit atomics");
+static_assert (ATOMIC_POINTER_LOCK_FREE == 2, "SharedFRList needs lock-free pointer sized atomics");
+
+// Allocates FRNodes from the segment mapped for Tag. Single FRNodes given
+// back with Free go on a stack shared by every process and are reused before
+// the segment grows. Arrays are never returned, FreeArray only exists to
+// satisfy the policy.
+template <class T, class Tag>
+struct FRSegmentAllocator
+{
+	typedef FRNode<T, FRSegmentAddressing<Tag> > Node;
+
+	static SharedSegmentHeader* Header ()
+	{
+		return (SharedSegmentHeader*)FRSegmentAddressing<Tag>::Base ();
+	}
+
+	static void* Reserve (size_t bytes)
+	{
+		SharedSegmentHeader* header = Header ();
+
+		// Keep every FRNode aligned so the flag bits of its offset stay clear
+		bytes = (bytes + alignof (Node) - 1) & ~(alignof (Node) - 1);
+
+		uint64_t offset = header->used.fetch_add (bytes);
+		if (offset + bytes > header->size)
+			throw std::bad_alloc ();
+
+		return FRSegmentAddressing<Tag>::Base () + offset;
+	}
+
+	// Pops a freed FRNode if there is one. A freed FRNode keeps the offset of
+	// the next one in its next field, and every pop bumps the tag so a stale
+	// pop fails even if the same FRNode is back on top.
+	static Node* Allocate (T data)
+	{
+		SharedSegmentHeader* header = Header ();
+		uint64_t top = header->freeNodes.load ();
+		while ((top & SHARED_FREE_OFFSET_MASK) != 0)
+		{
+			Node* n = (Node*)(FRSegmentAddressing<Tag>::Base () + (top & SHARED_FREE_OFFSET_MASK));
+			uint64_t tag = (top >> SHARED_FREE_OFFSET_BITS) + 1;
+			uint64_t next = n->next.ptr.load (std::memory_order_relaxed) & SHARED_FREE_OFFSET_MASK;
+			if (header->freeNodes.compare_exchange_weak (top, next | (tag << SHARED_FREE_OFFSET_BITS)))
+				return new (n) Node (data);
+		}
+
+		return new (Reserve (sizeof (Node))) Node (data);
+	}
+
+	static void Free (Node* n)
+	{
+		SharedSegmentHeader* header = Header ();
+		uint64_t offset = (uint64_t)((char*)n - FRSegmentAddressing<Tag>::Base ());
+		uint64_t top = header->freeNodes.load ();
+		do
+		{
+			n->next.ptr.store (top & SHARED_FREE_OFFSET_MASK, std::memory_order_relaxed);
+		} while (!header->freeNodes.compare_exchange_weak (top, offset | (top & ~SHARED_FREE_OFFSET_MASK)));
+	}
+
+	static Node* AllocateArray (size_t count)
+	{
+		Node* nodes = (Node*)Reserve (sizeof (Node) * count);
+		for (size_t i = 0; i < count; i++)
+			new (&nodes[i]) Node ();
+		return nodes;
+	}
+
+	static void FreeArray (Node*) {}
+};
+
+template <class T, class Tag>
+struct FRSharedPolicy : FRDefaultPolicy<T>
+{
+	typedef FRSegmentAddressing<Tag> Addressing;
+	typedef FRSegmentAllocator<T, Tag> Allocator;
+};
+
+/*
+ * An FRList whose FRNodes live in a POSIX shared memory segment so several
+ * processes can operate on one copy. References inside the segment are
+ * offsets, each process maps it wherever it likes. A process can only have
+ * one segment open per Tag.
+ */
+template <class T, class Tag = void>
+class SharedFRList
+{
+	public:
+		typedef FRList<T, FRSharedPolicy<T, Tag> > List;
+		typedef typename List::Node Node;
+
+	private:
+		char* segment;
+		size_t length;
+		List* list;
+
+		SharedSegmentHeader* Header ()
+		{
+			return (SharedSegmentHeader*)segment;
+		}
+
+		bool Map (int fd, size_t bytes)
+		{
+			void* mapped = mmap (NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+			if (mapped == MAP_FAILED)
+				return false;
+
+			segment = (char*)mapped;
+			length = bytes;
+			FRSegmentAddressing<Tag>::Base () = segment;
+			return true;
+		}
+
+	public:
+		SharedFRList ()
+		{
+			segment = NULL;
+			length = 0;
+			list = NULL;
+		}
+
+		~SharedFRList ()
+		{
+			Close ();
+		}
+
+		// Creates a new segment of the given size holding an empty list
+		bool Create (const char* name, size_t bytes)
+		{
+			if (segment != NULL || FRSegmentAddressing<Tag>::Base () != NULL || bytes < sizeof (SharedSegmentHeader) ||
+				bytes > SHARED_FREE_OFFSET_MASK)
+				return false;
+
+			int fd = shm_open (name, O_CREAT | O_EXCL | O_RDWR, 0600);
+			if (fd < 0)
+				return false;
+
+			bool mapped = ftruncate (fd, (off_t)bytes) == 0 && Map (fd, bytes);
+			close (fd);
+			if (!mapped)
+			{
+				shm_unlink (name);
+				return false;
+			}
+
+			SharedSegmentHeader* header = new (segment) SharedSegmentHeader;
+			header->ready.store (0);
+			memcpy (header->magic, SHARED_SEGMENT_MAGIC, sizeof (header->magic));
+			header->keySize = sizeof (T);
+			header->nodeSize = sizeof (Node);
+			header->size = bytes;
+			header->freeNodes.store (0);
+			header->used.store ((sizeof (SharedSegmentHeader) + alignof (Node) - 1) & ~(alignof (Node) - 1));
+
+			// Sentinels belong to the segment, so every process attaches to them
+			// and none of them frees them when it closes
+			Node* head = List::Allocator::AllocateArray (2);
+			Node* tail = head + 1;
+			head->data = List::Traits::Min ();
+			tail->data = List::Traits::Max ();
+			head->next.Set (tail, false, false);
+			tail->next.Set (NULL, false, false);
+			head->backlink.store (NULL);
+			tail->backlink.store (NULL);
+			header->head.store (FRSegmentAddressing<Tag>::Encode (head));
+			header->tail.store (FRSegmentAddressing<Tag>::Encode (tail));
+			list = new List (head, tail);
+
+			// Other processes wait for this before touching the list
+			header->ready.store (1);
+			return true;
+		}
+
+		// Attaches to a segment made by Create in this or another process
+		bool Open (const char* name)
+		{
+			if (segment != NULL || FRSegmentAddressing<Tag>::Base () != NULL)
+				return false;
+
+			int fd = shm_open (name, O_RDWR, 0600);
+			if (fd < 0)
+				return false;
+
+			// Create makes the segment before sizing it, wait until ftruncate has run
+			struct stat info;
+			int tries = 0;
+			bool sized = false;
+			while (!(sized = fstat (fd, &info) == 0 && (size_t)info.st_size >= sizeof (SharedSegmentHeader)) &&
+				tries++ < SHARED_SEGMENT_OPEN_TRIES)
+				usleep (1000);
+
+			bool mapped = sized && Map (fd, (size_t)info.st_size);
+			close (fd);
+			if (!mapped)
+				return false;
+
+			SharedSegmentHeader* header = Header ();
+			while (header->ready.load () == 0 && tries++ < SHARED_SEGMENT_OPEN_TRIES)
+				usleep (1000);
+
+			if (header->ready.load () == 0 ||
+				memcmp (header->magic, SHARED_SEGMENT_MAGIC, sizeof (header->magic)) != 0 ||
+				header->keySize != sizeof (T) ||
+				header->nodeSize != sizeof (Node) ||
+				header->size != length)
+			{
+				Close ();
+				return false;
+			}
+
+			list = new List ((Node*)FRSegmentAddressing<Tag>::Decode (header->head.load ()),
+				(Node*)FRSegmentAddressing<Tag>::Decode (header->tail.load ()));
+			return true;
+		}
+
+		// Unmaps the segment in this process, the segment itself stays until Unlink
+		void Close ()
+		{
+			if (list != NULL)
+			{
+				delete list;
+				list = NULL;
+			}
+
+			if (segment != NULL)
+			{
+				munmap (segment, length);
+				segment = NULL;
+				length = 0;
+				FRSegmentAddressing<Tag>::Base () = NULL;
+			}
+		}
+
+		static bool Unlink (const char* name)
+		{
+			return shm_unlink (name) == 0;
+		}
+
+		// FRNodes handed to Add must come from here so other processes can reach them.
+		// Reuses FRNodes given back with FreeNode first, then takes new space from
+		// the segment. Throws std::bad_alloc once the segment is full and nothing
+		// has been freed, so a segment of size bytes holds about
+		// (bytes - sizeof (SharedSegmentHeader)) / sizeof (Node) FRNodes at once.
+		Node* NewNode (T data)
+		{
+			return List::Allocator::Allocate (data);
+		}
+
+		// Gives an FRNode returned by Remove back to the segment. Nothing reclaims
+		// removed FRNodes automatically, so only call this once no operation in
+		// any process that started before the Remove can still be running.
+		void FreeNode (Node* n)
+		{
+			List::Allocator::Free (n);
+		}
+
+		List* GetList ()
+		{
+			return list;
+		}
+};
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef SPARSE_INDEX_H
+#define SPARSE_INDEX_H
+
+#include "FRNode.hpp"
+#include "FRPolicy.hpp"
+#include <vector>
+
+// Read-only sorted shortcuts into an FRList, rebuilt and swapped in whole
+template <class T, class Traits = FRKeyTraits<T>, class Addressing = FRRawAddressing>
+class SparseIndex
+{
+	public:
+		// Kept in separate arrays so the binary search only touches keys
+		std::vector<T> keys;
+		std::vector<FRNode<T, Addressing>*> nodes;
+
+		void Append (T key, FRNode<T, Addressing>* n)
+		{
+			keys.push_back (key);
+			nodes.push_back (n);
+		}
+
+		// Returns the last shortcut with key <= data, or NULL if there is none
+		FRNode<T, Addressing>* Find (T data)
+		{
+			size_t low = 0;
+			size_t high = keys.size ();
+			while (low < high)
+			{
+				size_t mid = low + (high - low) / 2;
+				if (!Traits::Less (data, keys[mid]))
+					low = mid + 1;
+				else
+					high = mid;
+			}
+
+			return (low == 0) ? NULL : nodes[low - 1];
+		}
+};
+
+#endif
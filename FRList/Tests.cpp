@@ -1,9 +1,20 @@
 #include <stdio.h>
 #include <stdarg.h>
-#include "Node.hpp"
+#include <climits>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <thread>
+#include <vector>
+#include "FRNode.hpp"
 #include "MarkableReference.hpp"
 #include "Window.hpp"
+#include "SparseIndex.hpp"
+#include "FRPolicy.hpp"
+#include "FlatCombiner.hpp"
 #include "FRList.hpp"
+#include "FRSnapshot.hpp"
+#include "SharedFRList.hpp"
 
 class Results
 {
@@ -55,7 +66,7 @@ bool MarkableReferenceTests ()
 	Results r;
 
 	// Initialization
-	Node<int> n (5);
+	FRNode<int> n (5);
 	MarkableReference<int> mr (&n);// Markable Reference to n
 
 	// Pointer resolution test no flags
@@ -84,29 +95,36 @@ bool MarkableReferenceTests ()
 	r.Assert ((mr.GetReference() == &n), "Pointer points to [%p] but should point to [%p] with both flag\n", mr.GetReference(), &n);
 
 	// Compare and swap test
-	Node<int> n2 (7);
+	FRNode<int> n2 (7);
 	mr.CompareAndSet (&n, &n2, true, false, true, false);
 	r.Assert ((mr.GetReference() == &n2 && !mr.IsSuccessorMarked() && !mr.IsMarkedForDeletion()),
 		"Compare and swap failed. Pointer should be [%p] was [%p], successor flag should be false was %s, deletion mark should be false was %s\n",
 		&n2, mr.GetReference(), (mr.IsSuccessorMarked() ? "true" : "false"), (mr.IsMarkedForDeletion() ? "true" : "false"));
 
+	// One load decodes to a consistent reference and flags
+	mr.Set (&n, true, false);
+	uintptr_t word = mr.Load ();
+	r.Assert ((mr.GetReference(word) == &n && mr.IsSuccessorMarked(word) && !mr.IsMarkedForDeletion(word)),
+		"Decoding one load gave [%p], successor %s, deletion %s\n", mr.GetReference(word),
+		(mr.IsSuccessorMarked(word) ? "true" : "false"), (mr.IsMarkedForDeletion(word) ? "true" : "false"));
+
 	r.PrintResults ();
 
 	return r.AllPasses ();
 }
 
-bool NodeTests ()
+bool FRNodeTests ()
 {
-	printf ("===================== Starting Node.hpp Unit Tests =====================\n");
+	printf ("==================== Starting FRNode.hpp Unit Tests ====================\n");
 
 	Results r;
 
 	// Initialization test
-	Node<int> n (5);
+	FRNode<int> n (5);
 	r.Assert ((n.data == 5), "Failed Node initialization test, %d != 5\n", n.data);
 
 	// Backlink test
-	Node<int> n2 (7);
+	FRNode<int> n2 (7);
 	n.backlink.store(&n2);
 	r.Assert ((n.backlink.load() == &n2), "Stored [%p] into the backlink but retrieved [%p]\n", &n2, n.backlink.load());
 
@@ -122,8 +140,8 @@ bool WindowTests ()
 	Results r;
 
 	// Initialization test
-	Node<int> n1 (5);
-	Node<int> n2 (7);
+	FRNode<int> n1 (5);
+	FRNode<int> n2 (7);
 	Window<int> w (&n1, &n2);
 	r.Assert ((w.pred->data == 5 && w.curr->data == 7), "Failed initialization test pred.data should be 5 was %d and curr.data should be 7 was %d\n",
 		w.pred->data, w.curr->data);
@@ -133,6 +151,279 @@ bool WindowTests ()
 	return r.AllPasses ();
 }
 
+bool SparseIndexTests ()
+{
+	printf ("================= Starting SparseIndex.hpp Unit Tests ==================\n");
+
+	Results r;
+
+	// Empty index has no shortcuts
+	SparseIndex<int> index;
+	r.Assert ((index.Find(5) == NULL), "Find (5) on an empty index returned [%p] instead of null\n", index.Find(5));
+
+	FRNode<int> n1 (10);
+	FRNode<int> n2 (20);
+	FRNode<int> n3 (30);
+	index.Append (10, &n1);
+	index.Append (20, &n2);
+	index.Append (30, &n3);
+
+	// Below the first shortcut
+	r.Assert ((index.Find(9) == NULL), "Find (9) returned [%p] but nothing is <= 9\n", index.Find(9));
+
+	// Exact and in between matches
+	r.Assert ((index.Find(20) == &n2), "Find (20) returned [%p] but should be [%p]\n", index.Find(20), &n2);
+	r.Assert ((index.Find(25) == &n2), "Find (25) returned [%p] but should be [%p]\n", index.Find(25), &n2);
+	r.Assert ((index.Find(99) == &n3), "Find (99) returned [%p] but should be [%p]\n", index.Find(99), &n3);
+
+	r.PrintResults ();
+
+	return r.AllPasses ();
+}
+
+// Descending order with every optional feature turned on
+struct DescendingTraits
+{
+	static int Min () { return INT_MAX; }
+	static int Max () { return INT_MIN; }
+	static bool Less (int a, int b) { return a > b; }
+	static int Before (int k) { return k + 1; }
+};
+
+// Counts how often the list brackets work with Enter and Leave
+struct CountingReclaimer : FRNoReclaimer
+{
+	static int entered;
+	static int inside;
+
+	static void Enter () { entered++; inside++; }
+	static void Leave () { inside--; }
+};
+
+int CountingReclaimer::entered = 0;
+int CountingReclaimer::inside = 0;
+
+struct ReclaimerPolicy : FRDefaultPolicy<int>
+{
+	typedef CountingReclaimer Reclaimer;
+};
+
+struct TestPolicy : FRDefaultPolicy<int>
+{
+	typedef DescendingTraits Traits;
+	typedef FRExponentialBackoff Backoff;
+	typedef FRCountingStats Stats;
+};
+
+bool FRPolicyTests ()
+{
+	printf ("=================== Starting FRPolicy.hpp Unit Tests ===================\n");
+
+	Results r;
+
+	// Default key traits
+	r.Assert ((FRKeyTraits<int>::Min() == INT_MIN && FRKeyTraits<int>::Max() == INT_MAX),
+		"Default sentinels should be INT_MIN and INT_MAX but were %d and %d\n", FRKeyTraits<int>::Min(), FRKeyTraits<int>::Max());
+	r.Assert ((FRKeyTraits<int>::Before(7) == 6), "FRKeyTraits::Before (7) returned %d instead of 6\n", FRKeyTraits<int>::Before(7));
+
+	// Counting stats
+	FRCountingStats stats;
+	stats.CasFailure ();
+	stats.CasFailure ();
+	stats.Help ();
+	r.Assert ((stats.casFailures.load() == 2 && stats.helps.load() == 1 && stats.backtracks.load() == 0),
+		"Counting stats recorded (%lu, %lu, %lu) instead of (2, 1, 0)\n", stats.casFailures.load(), stats.helps.load(), stats.backtracks.load());
+
+	// List using a custom comparator
+	FRList<int, TestPolicy> list;
+	FRNode<int> n1 (3);
+	FRNode<int> n2 (8);
+	FRNode<int> n3 (5);
+	list.Add (&n1);
+	list.Add (&n2);
+	list.Add (&n3);
+	r.Assert ((list.Contains(3) && list.Contains(5) && list.Contains(8) && !list.Contains(4)),
+		"List with descending traits did not match its contents\n");
+
+	FRNode<int>* retVal = list.Remove (5);
+	r.Assert ((retVal == &n3 && !list.Contains(5) && list.Contains(8)),
+		"Remove (5) with descending traits returned [%p] but should be [%p]\n", retVal, &n3);
+
+	// Floating point keys step back to the closest smaller key
+	r.Assert ((FRKeyTraits<double>::Before(0.7) < 0.7 && FRKeyTraits<double>::Before(0.7) > 0.69),
+		"FRKeyTraits<double>::Before (0.7) returned %lf\n", FRKeyTraits<double>::Before(0.7));
+
+	FRList<double> doubleList;
+	FRNode<double> d1 (0.5);
+	FRNode<double> d2 (0.7);
+	doubleList.Add (&d1);
+	doubleList.Add (&d2);
+	FRNode<double>* doubleVal = doubleList.Remove (0.7);
+	r.Assert ((doubleVal == &d2 && !doubleList.Contains(0.7) && doubleList.Contains(0.5)),
+		"Remove (0.7) on a double list returned [%p] but should be [%p]\n", doubleVal, &d2);
+
+	// Unsigned keys equal to the head sentinel are rejected instead of wrapping
+	FRList<unsigned int> unsignedList;
+	FRNode<unsigned int> u0 (0);
+	FRNode<unsigned int> u1 (1);
+	unsignedList.Add (&u0);
+	unsignedList.Add (&u1);
+	r.Assert ((unsignedList.Remove(0) == NULL && !unsignedList.Contains(0)), "Key 0 equal to the unsigned head sentinel was stored\n");
+	r.Assert ((unsignedList.Remove(1) == &u1 && !unsignedList.Contains(1)), "Remove (1) on an unsigned list did not return its FRNode\n");
+
+	// Walks outside of Add, Remove and Contains are bracketed by the reclaimer too
+	FRList<int, ReclaimerPolicy> reclaimedList;
+	FRNode<int> c1 (4);
+	reclaimedList.Add (&c1);
+	int enteredBefore = CountingReclaimer::entered;
+	reclaimedList.RebuildIndex (1);
+	r.Assert ((CountingReclaimer::entered == enteredBefore + 1 && CountingReclaimer::inside == 0),
+		"RebuildIndex entered the reclaimer %d times, %d still inside\n", CountingReclaimer::entered - enteredBefore, CountingReclaimer::inside);
+	enteredBefore = CountingReclaimer::entered;
+	SaveSnapshot (reclaimedList, "frlist_reclaimer.snap");
+	remove ("frlist_reclaimer.snap");
+	r.Assert ((CountingReclaimer::entered == enteredBefore + 1 && CountingReclaimer::inside == 0),
+		"SaveSnapshot entered the reclaimer %d times, %d still inside\n", CountingReclaimer::entered - enteredBefore, CountingReclaimer::inside);
+
+	r.PrintResults ();
+
+	return r.AllPasses ();
+}
+
+struct CombiningPolicy : FRDefaultPolicy<int>
+{
+	typedef FRFlatCombining<int> Contention;
+};
+
+// Scores decay over time, so keep failing until the region turns hot
+template <class Combining>
+bool MakeHot (Combining& combining, int key)
+{
+	for (int i = 0; i < Combining::HOT_THRESHOLD * 4 && !combining.IsHot(key); i++)
+		combining.CasFailure (key);
+	return combining.IsHot (key);
+}
+
+bool FlatCombinerTests ()
+{
+	printf ("================= Starting FlatCombiner.hpp Unit Tests =================\n");
+
+	Results r;
+
+	typedef FRFlatCombining<int> Combining;
+	Combining* combining = new Combining ();
+
+	// Regions only turn hot after sustained failures
+	r.Assert ((!combining->IsHot(5)), "Region for 5 started out hot\n");
+	for (int i = 0; i < Combining::HOT_THRESHOLD - 1; i++)
+		combining->CasFailure (5);
+	r.Assert ((!combining->IsHot(5)), "Region for 5 turned hot before %d failures\n", Combining::HOT_THRESHOLD);
+	r.Assert ((MakeHot (*combining, 5) && combining->IsHot(6)), "Region for 5 and 6 did not turn hot\n");
+	r.Assert ((!combining->IsHot(500)), "Failures on 5 made the region for 500 hot\n");
+
+	// Keys a multiple of 64 regions away share the region but not its heat
+	r.Assert ((!combining->IsHot(5 + 16 * 64)), "Failures on 5 made the aliased key %d hot\n", 5 + 16 * 64);
+
+	// Scores decay with time rather than with operations
+	for (int i = 0; i < Combining::HOT_THRESHOLD / 2; i++)
+		combining->CasFailure (300);
+	std::this_thread::sleep_for (std::chrono::milliseconds (10));
+	for (int i = 0; i < Combining::HOT_THRESHOLD / 2; i++)
+		combining->CasFailure (300);
+	r.Assert ((!combining->IsHot(300)), "Region for 300 turned hot from failures 10ms apart\n");
+
+	// Publish and collect a batch
+	FRNode<int> n (6);
+	Combining::Request* add = combining->Publish (FR_ADD, 6, &n);
+	Combining::Request* contains = combining->Publish (FR_CONTAINS, 5, NULL);
+	Combining::Request* batch [Combining::SLOTS];
+	r.Assert ((add != NULL && contains != NULL && add != contains), "Publish returned [%p] and [%p]\n", add, contains);
+	r.Assert ((combining->TryLock(5) && !combining->TryLock(6)), "Region lock was not exclusive\n");
+
+	int count = combining->Collect (5, batch);
+	r.Assert ((count == 2 && combining->Collect(5, batch) == 0), "Collected %d requests instead of 2, or collected them twice\n", count);
+	combining->Finish (5, batch, count);
+	combining->Unlock (5);
+	r.Assert ((combining->IsDone(add) && combining->IsDone(contains)), "Finished requests were not marked done\n");
+	combining->Release (add);
+	combining->Release (contains);
+
+	// Batches with nobody else to combine with cool the region down
+	for (int i = 0; i < Combining::COOL_BATCHES; i++)
+	{
+		combining->TryLock (5);
+		count = combining->Collect (5, batch);
+		combining->Finish (5, batch, count);
+		combining->Unlock (5);
+	}
+	r.Assert ((!combining->IsHot(5)), "Region for 5 was still hot after %d empty batches\n", Combining::COOL_BATCHES);
+	delete combining;
+
+	// List operations routed through the combiner
+	FRList<int, CombiningPolicy>* list = new FRList<int, CombiningPolicy> ();
+	MakeHot (list->GetContention(), 20);
+
+	FRNode<int> n1 (18);
+	FRNode<int> n2 (21);
+	list->Add (&n1);
+	list->Add (&n2);
+	r.Assert ((list->GetContention().IsHot(20)), "Region for 20 cooled down too early\n");
+	r.Assert ((list->Contains(18) && list->Contains(21) && !list->Contains(20)), "Combined operations did not match the list contents\n");
+
+	FRNode<int>* retVal = list->Remove (21);
+	r.Assert ((retVal == &n2 && !list->Contains(21)), "Combined Remove (21) returned [%p] but should be [%p]\n", retVal, &n2);
+	delete list;
+
+	// Several threads combined into one batch. Holding the region lock keeps
+	// every request pending until all threads have published theirs.
+	list = new FRList<int, CombiningPolicy> ();
+	FRNode<int> present34 (34);
+	FRNode<int> present36 (36);
+	FRNode<int> added33 (33);
+	FRNode<int> added35 (35);
+	FRNode<int> added40 (40);
+	list->Add (&present34);
+	list->Add (&present36);
+	r.Assert ((MakeHot (list->GetContention(), 32)), "Region for 32 did not turn hot\n");
+	r.Assert ((list->GetContention().TryLock(32)), "Could not take the lock for region 32\n");
+
+	std::atomic<int> started (0);
+	FRNode<int>* removed34 = NULL;
+	FRNode<int>* removed40 = NULL;
+	bool found36 = false;
+	bool found47 = true;
+	std::thread threads [] = {
+		std::thread ([&] { started++; list->Add (&added33); }),
+		std::thread ([&] { started++; list->Add (&added35); }),
+		std::thread ([&] { started++; removed34 = list->Remove (34); }),
+		std::thread ([&] { started++; found36 = list->Contains (36); }),
+		std::thread ([&] { started++; found47 = list->Contains (47); }),
+		std::thread ([&] { started++; list->Add (&added40); }),
+		std::thread ([&] { started++; removed40 = list->Remove (40); })};
+
+	while (started.load () < 7)
+		std::this_thread::yield ();
+	std::this_thread::sleep_for (std::chrono::milliseconds (50));
+	list->GetContention().Unlock (32);
+	for (int i = 0; i < 7; i++)
+		threads[i].join ();
+
+	r.Assert ((list->Contains(33) && list->Contains(35) && !list->Contains(34) && list->Contains(36)),
+		"Concurrent combined batch did not match the list contents\n");
+	r.Assert ((removed34 == &present34 && found36 && !found47),
+		"Concurrent combined batch returned Remove (34) [%p], Contains (36) %s, Contains (47) %s\n",
+		removed34, (found36 ? "true" : "false"), (found47 ? "true" : "false"));
+
+	// Add and Remove of 40 in one batch may apply in either order, but the list has to agree
+	r.Assert (((removed40 == &added40) == !list->Contains(40) && (removed40 == NULL || removed40 == &added40)),
+		"Remove (40) returned [%p] but Contains (40) is %s\n", removed40, (list->Contains(40) ? "true" : "false"));
+	delete list;
+
+	r.PrintResults ();
+
+	return r.AllPasses ();
+}
+
 bool FRListTests ()
 {
 	printf ("==================== Starting FRList.hpp Unit Tests ====================\n");
@@ -145,11 +436,11 @@ bool FRListTests ()
 	r.Assert ((!list.Contains(5)), "Called contains (5) on an empty list and got true\n");
 
 	// Remove on empty list
-	Node<int>* retVal = list.Remove (5);
+	FRNode<int>* retVal = list.Remove (5);
 	r.Assert ((retVal == NULL), "Called Remove (5) on an empty list and got [%p] instead of null\n", retVal);
 
 	// Insert a node
-	Node<int> n (7);
+	FRNode<int> n (7);
 	list.Add (&n);
 	r.Assert ((list.Contains(7)), "Inserted node (data %d, addr[%p]) into list but did not find it with contains\n", n.data, &n);
 
@@ -157,6 +448,211 @@ bool FRListTests ()
 	retVal = list.Remove(7);
 	r.Assert ((retVal == &n), "Tried Remove (7) and got address [%p] but should be [%p]\n", retVal, &n);
 
+	// Snapshot round trip skips removed nodes
+	FRNode<int> s1 (3);
+	FRNode<int> s2 (9);
+	FRNode<int> s3 (12);
+	list.Add (&s1);
+	list.Add (&s2);
+	list.Add (&s3);
+	list.Remove (9);
+	r.Assert ((SaveSnapshot (list, "frlist_test.snap")), "SaveSnapshot (frlist_test.snap) failed\n");
+
+	FRList<int> loadedList;
+	FRNode<int>* loadedNodes;
+	size_t loadedCount;
+	bool loaded = LoadSnapshot (loadedList, "frlist_test.snap", &loadedNodes, &loadedCount);
+	r.Assert ((loaded && loadedCount == 2), "LoadSnapshot returned %s with %lu nodes but should load 2\n",
+		(loaded ? "true" : "false"), (unsigned long)loadedCount);
+	r.Assert ((loadedList.Contains(3) && loadedList.Contains(12) && !loadedList.Contains(9)),
+		"Loaded list should contain 3 and 12 but not 9\n");
+
+	// Loaded list behaves like any other
+	FRNode<int> s4 (5);
+	loadedList.Add (&s4);
+	r.Assert ((loadedList.Contains(5)), "Could not add 5 to a list loaded from a snapshot\n");
+
+	// Snapshots only load into empty lists
+	FRNode<int>* unusedNodes;
+	size_t unusedCount;
+	r.Assert ((!LoadSnapshot (list, "frlist_test.snap", &unusedNodes, &unusedCount)), "LoadSnapshot succeeded on a non-empty list\n");
+
+	// Truncated snapshots are rejected
+	char snapshotBytes [64];
+	FILE* snapshotFile = fopen ("frlist_test.snap", "rb");
+	size_t snapshotLength = fread (snapshotBytes, 1, sizeof (snapshotBytes), snapshotFile);
+	fclose (snapshotFile);
+	snapshotFile = fopen ("frlist_test.snap", "wb");
+	fwrite (snapshotBytes, 1, snapshotLength - sizeof (int), snapshotFile);
+	fclose (snapshotFile);
+
+	FRList<int> truncatedList;
+	r.Assert ((!LoadSnapshot (truncatedList, "frlist_test.snap", &unusedNodes, &unusedCount) && !truncatedList.Contains(3)),
+		"LoadSnapshot accepted a truncated snapshot\n");
+
+	remove ("frlist_test.snap");
+
+	// Operations starting from index shortcuts
+	FRList<int> indexedList;
+	FRNode<int>* indexedNodes = new FRNode<int> [100];
+	for (int i = 0; i < 100; i++)
+	{
+		indexedNodes[i].data = i * 2;
+		indexedList.Add (&indexedNodes[i]);
+	}
+	indexedList.RebuildIndex (8);
+
+	bool allFound = true;
+	for (int i = 0; i < 100; i++)
+		allFound &= indexedList.Contains (i * 2) && !indexedList.Contains (i * 2 + 1);
+	r.Assert ((allFound), "Indexed list did not match its contents\n");
+
+	// Removing a shortcut node falls back through its backlink, with a
+	// stride of 8 the shortcuts are every eighth key starting at 14
+	retVal = indexedList.Remove (14);
+	r.Assert ((retVal == &indexedNodes[7] && !indexedList.Contains(14) && indexedList.Contains(12) && indexedList.Contains(16)),
+		"Removing shortcut node 14 returned [%p] but should be [%p]\n", retVal, &indexedNodes[7]);
+
+	FRNode<int> odd (15);
+	indexedList.Add (&odd);
+	r.Assert ((indexedList.Contains(15) && !indexedList.Contains(14) && indexedList.Contains(16)),
+		"Could not add 15 after its shortcut was removed\n");
+
+	// Background maintenance
+	r.Assert ((indexedList.StartIndexMaintenance (4, 1)), "StartIndexMaintenance (4, 1) failed\n");
+	r.Assert ((!indexedList.StartIndexMaintenance (4, 1)), "StartIndexMaintenance succeeded while already running\n");
+	r.Assert ((indexedList.Contains(198) && indexedList.Remove(198) == &indexedNodes[99]), "Could not remove 198 with maintenance running\n");
+	indexedList.StopIndexMaintenance ();
+	r.Assert ((indexedList.Contains(0) && !indexedList.Contains(198)), "List changed after stopping index maintenance\n");
+	delete [] indexedNodes;
+	FRList<int>::Allocator::FreeArray (loadedNodes);
+
+	// Threads on interleaved but disjoint keys keep flagging each other's
+	// predecessors, so every result is known even though they all overlap.
+	// Helping a successor read apart from its flag used to lose keys here.
+	const int STRESS_THREADS = 8;
+	const int STRESS_OPS = 20000;
+	const int STRESS_KEYS = 64;
+	FRList<int> stressList;
+	FRNode<int>* stressNodes = new FRNode<int> [STRESS_THREADS * STRESS_OPS];
+	std::atomic<int> stressErrors (0);
+	std::vector<std::thread> stressThreads;
+	for (int t = 0; t < STRESS_THREADS; t++)
+	{
+		stressThreads.push_back (std::thread ([&, t] {
+			std::vector<bool> present (STRESS_KEYS, false);
+			unsigned int seed = t + 1;
+			for (int i = 0; i < STRESS_OPS; i++)
+			{
+				int slot = rand_r (&seed) % STRESS_KEYS;
+				int key = slot * STRESS_THREADS + t + 1;
+				int op = rand_r (&seed) % 3;
+				if (op == 0)
+				{
+					FRNode<int>* node = &stressNodes[t * STRESS_OPS + i];
+					node->data = key;
+					stressList.Add (node);
+					present[slot] = true;
+				}
+				else if (op == 1)
+				{
+					if ((stressList.Remove (key) != NULL) != present[slot])
+						stressErrors++;
+					present[slot] = false;
+				}
+				else if (stressList.Contains (key) != present[slot])
+					stressErrors++;
+			}
+			for (int slot = 0; slot < STRESS_KEYS; slot++)
+				if (stressList.Contains (slot * STRESS_THREADS + t + 1) != present[slot])
+					stressErrors++;
+		}));
+	}
+	for (int t = 0; t < STRESS_THREADS; t++)
+		stressThreads[t].join ();
+	r.Assert ((stressErrors.load () == 0), "%d results were wrong with %d threads on disjoint keys\n", stressErrors.load (), STRESS_THREADS);
+	delete [] stressNodes;
+
+	r.PrintResults ();
+
+	return r.AllPasses ();
+}
+
+bool SharedFRListTests ()
+{
+	printf ("================== Starting SharedFRList.hpp Unit Tests ================\n");
+
+	Results r;
+
+	const char* name = "/frlist_test_segment";
+	SharedFRList<int>::Unlink (name);// Leftover from an earlier failed run
+
+	SharedFRList<int> shared;
+	r.Assert ((shared.Create (name, 1 << 20)), "Could not create shared segment %s\n", name);
+	r.Assert ((!shared.Open (name)), "Opened a second segment with the same tag\n");
+
+	// A segment only opens for the key type it was created with
+	struct OtherTag;
+	SharedFRList<double, OtherTag> wrongType;
+	r.Assert ((!wrongType.Open (name)), "Opened an int segment as a list of doubles\n");
+
+	SharedFRList<int>::List* list = shared.GetList ();
+	list->Add (shared.NewNode (4));
+	list->Add (shared.NewNode (6));
+
+	// Offset based references survive a different mapping in another process
+	pid_t child = fork ();
+	if (child == 0)
+	{
+		shared.Close ();
+
+		SharedFRList<int> other;
+		bool ok = other.Open (name) && other.GetList ()->Contains (4);
+		if (ok)
+		{
+			other.GetList ()->Add (other.NewNode (5));
+			ok = other.GetList ()->Remove (6) != NULL;
+		}
+		other.Close ();
+		_exit (ok ? 0 : 1);
+	}
+
+	int status = -1;
+	waitpid (child, &status, 0);
+	r.Assert ((WIFEXITED (status) && WEXITSTATUS (status) == 0), "Child process could not use the shared list\n");
+	r.Assert ((list->Contains(4) && list->Contains(5) && !list->Contains(6)),
+		"Shared list did not see the child's changes, contains 4: %d, 5: %d, 6: %d\n", list->Contains(4), list->Contains(5), list->Contains(6));
+
+	// Freed FRNodes are reused before the segment grows
+	SharedFRList<int>::Node* removed = list->Remove (4);
+	shared.FreeNode (removed);
+	r.Assert ((shared.NewNode (8) == removed), "NewNode did not reuse the FRNode freed after Remove (4)\n");
+
+	shared.Close ();
+	r.Assert ((SharedFRList<int>::Unlink (name)), "Could not unlink shared segment %s\n", name);
+
+	// Add and Remove churn far beyond the segment's capacity
+	r.Assert ((shared.Create (name, 4096)), "Could not create small shared segment %s\n", name);
+	list = shared.GetList ();
+	bool churned = true;
+	try
+	{
+		for (int i = 0; i < 10000 && churned; i++)
+		{
+			list->Add (shared.NewNode (i % 50 + 1));
+			SharedFRList<int>::Node* n = list->Remove (i % 50 + 1);
+			churned = n != NULL;
+			shared.FreeNode (n);
+		}
+	}
+	catch (std::bad_alloc&)
+	{
+		churned = false;
+	}
+	r.Assert ((churned), "Segment ran out of space under Add and Remove churn\n");
+	shared.Close ();
+	SharedFRList<int>::Unlink (name);
+
 	r.PrintResults ();
 
 	return r.AllPasses ();
@@ -166,9 +662,13 @@ int main ()
 {
 	bool anyFailures = false;
 	anyFailures |= !MarkableReferenceTests ();
-	anyFailures |= !NodeTests ();
+	anyFailures |= !FRNodeTests ();
 	anyFailures |= !WindowTests ();
+	anyFailures |= !SparseIndexTests ();
+	anyFailures |= !FRPolicyTests ();
+	anyFailures |= !FlatCombinerTests ();
 	anyFailures |= !FRListTests ();
+	anyFailures |= !SharedFRListTests ();
 
 	if (anyFailures)
 		printf ("[ERROR] Test(s) did not complete successfully, please review!!!\n");
@@ -3,14 +3,14 @@
 
 #include "FRNode.hpp"
 
-template <class T>
+template <class T, class Addressing = FRRawAddressing>
 class Window
 {
 	public:
-		FRNode<T>* pred;
-		FRNode<T>* curr;
+		FRNode<T, Addressing>* pred;
+		FRNode<T, Addressing>* curr;
 
-		Window (FRNode<T>* _pred, FRNode<T>* _curr)
+		Window (FRNode<T, Addressing>* _pred, FRNode<T, Addressing>* _curr)
 		{
 			pred = _pred;
 			curr = _curr;
@@ -1,131 +1,380 @@
 #include <stdio.h>
+#include <string.h>
 #define HAVE_STRUCT_TIMESPEC // Needed so pthreadwin32 does not overwrite struct timespec
 #include <pthread.h>
+#include <unistd.h>
 #include <ctime>
 #include <cstdlib>
+#include <chrono>
 #include <vector>
+#include <string>
+#include <algorithm>
 
-#include "FRList\FRList.hpp"
-#include "FRList\FRNode.hpp"
+#include "FRList/FRList.hpp"
+#include "FRList/FRNode.hpp"
+#include "FRList/FRPolicy.hpp"
+#include "FRList/FlatCombiner.hpp"
 
-#define OPS_PER_THREAD 5
+#define OPS_PER_THREAD 100000
+#define KEY_RANGE 1000
+#define RUNS 3
+#define INDEX_STRIDE 32
+#define INDEX_INTERVAL_MS 10
+#define LATENCY_SAMPLE_INTERVAL 64// Only every 64th operation is timed, so clock reads barely touch throughput
 
+struct BackoffPolicy : FRDefaultPolicy<int>
+{
+	typedef FRExponentialBackoff Backoff;
+};
+
+struct CombiningPolicy : FRDefaultPolicy<int>
+{
+	typedef FRFlatCombining<int> Contention;
+};
+
+struct BenchConfig
+{
+	int runs;
+	int opsPerThread;
+	int keyRange;
+	const char* variant;
+	const char* jsonPath;
+	const char* csvPath;
+};
+
+// One row of output, every run of every configuration gets its own
+struct FRResult
+{
+	std::string variant;
+	int threads;
+	int addChance;
+	int removeChance;
+	int containsChance;
+	int keyRange;
+	long ops;
+	int run;
+	double seconds;
+	double throughput;
+	long p50;
+	long p90;
+	long p99;
+	long max;
+};
+
+template <class List>
 struct FRThreadData
 {
 	int threadId;
-	FRList<int>* list;
-	std::vector<FRNode<int>>* nodeArray;
+	unsigned int seed;
+	List* list;
+	FRNode<int>* nodeArray;
+	int arrayIndex;
+	int opsPerThread;
+	int keyRange;
 	int addChance;
 	int removeChance;
 	int containsChance;
+	std::vector<long> latencies;// Nanoseconds for each sampled operation
 };
 
+template <class List>
 void* FRThreadLogic (void* threadArgs)
 {
-	/*// Cast pointer to data struct so we can use it
-	struct FRThreadData* data;
-	data = (struct FRThreadData*) threadArgs;
+	// Cast pointer to data struct so we can use it
+	FRThreadData<List>* data = (FRThreadData<List>*) threadArgs;
 
 	// Do all the operations
-	for (int ops = 0; ops < OPS_PER_THREAD; ops++)
+	for (int ops = 0; ops < data->opsPerThread; ops++)
 	{
-		int random = rand () % 1000 + 1;
+		int random = rand_r (&data->seed) % 1000;
+		int key = rand_r (&data->seed) % data->keyRange + 1;// Keys are in range [1, keyRange]
+
+		bool sampled = ops % LATENCY_SAMPLE_INTERVAL == 0;
+		std::chrono::steady_clock::time_point begin;
+		if (sampled)
+			begin = std::chrono::steady_clock::now ();
+
 		if (random < data->addChance)// Add
 		{
-			// Grab node from list
+			// Grab node from the preallocated array
 			FRNode<int>* n = &data->nodeArray[data->arrayIndex++];
-			n->data = random;// Data will be range [1, addChance)
-
-			// Add the node
+			n->data = key;
 			data->list->Add (n);
 		}
 		else if (random < data->addChance + data->removeChance)// Remove
 		{
-			data->list->Remove (random - data->removeChance);// Remove something in range [1, addChance)
+			data->list->Remove (key);
 		}
 		else // Contains
 		{
-			data->list->Contains (random - data->removeChance - data->containsChance);// Look for something in range [1, addChance)
+			data->list->Contains (key);
 		}
-	}*/
+
+		if (sampled)
+		{
+			std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now ();
+			data->latencies.push_back (std::chrono::duration_cast<std::chrono::nanoseconds> (end - begin).count ());
+		}
+	}
+
+	return NULL;
 }
 
-double* FRDoTest (double* times, int addChance, int removeChance, int containsChance)
+long Percentile (std::vector<long>& values, double percent)
 {
-	if (addChance + removeChance + containsChance != 1000)
-		printf ("[ERROR] FRDoTest called with invalid parameters\n\tAdd (%d) + Remove (%d) + Contains (%d) != 100!\n", addChance, removeChance, containsChance);
+	if (values.empty ())
+		return 0;
+
+	size_t index = (size_t)(percent / 100.0 * (values.size () - 1));
+	std::nth_element (values.begin (), values.begin () + index, values.end ());
+	return values[index];
+}
 
-	times = new double [4];
+template <class List>
+void FRDoTest (std::vector<FRResult>& results, const BenchConfig& config, const char* variant, bool useIndex,
+	int addChance, int removeChance, int containsChance)
+{
+	if (addChance + removeChance + containsChance != 1000)
+		printf ("[ERROR] FRDoTest called with invalid parameters\n\tAdd (%d) + Remove (%d) + Contains (%d) != 1000!\n", addChance, removeChance, containsChance);
 
-	printf ("\n===== Starting FRList Test - %d Add, %d Remove, %d Contains =====\n", addChance, removeChance, containsChance);
+	printf ("\n===== Starting FRList Test (%s) - %d Add, %d Remove, %d Contains =====\n", variant, addChance, removeChance, containsChance);
 
 	int threadCounts [] = {1, 2, 4, 8};
 	for (int threadCountIndex = 0; threadCountIndex < 4; threadCountIndex++)
 	{
 		int numThreads = threadCounts[threadCountIndex];
-		printf ("Testing with %d threads \n", numThreads);
 
-		FRList<int> list;
-
-		printf ("Allocating nodes...\n");
-		// Create OPS_PER_THREAD nodes for each thread so they can't run out
-		
-		/*
-		printf ("Creating thread data...\n");
-		struct FRThreadData* threadData = new struct FRThreadData [numThreads];
-		for (int i = 0; i < numThreads; i++)
+		for (int run = 0; run < config.runs; run++)
 		{
-			threadData[i].threadId = i;
-			threadData[i].list = &list;
-			threadData[i].nodeArray = preallocatedNodes[i];
-			threadData[i].arrayIndex = 0;
-			threadData[i].addChance = addChance;
-			threadData[i].removeChance = removeChance;
-			threadData[i].containsChance = containsChance;
-		}*/
-
-		/* pthread_t* threads = new pthread_t [numThreads];
-
-		printf ("Starting evaluation...\n");
-		clock_t begin = clock ();
-		// Spin off threads
-		for (int i = 0; i < numThreads; i++)
-			pthread_create (&threads[i], NULL, FRThreadLogic, (void*)&threadData[i]);
-
-		// Join them back together
-		for (int i = 0; i < numThreads; i++)
-			pthread_join (threads[i], NULL);
-
-		clock_t end = clock (); 
-
-		times [threadCountIndex] = double (begin-end) / CLOCKS_PER_SEC;*/
-	}
+			List list;
+
+			// Start half full so removes and contains have something to find
+			std::vector<FRNode<int>> initialNodes (config.keyRange / 2);
+			for (size_t i = 0; i < initialNodes.size (); i++)
+			{
+				initialNodes[i].data = (int)(i * 2 + 1);
+				list.Add (&initialNodes[i]);
+			}
+
+			if (useIndex)
+				list.StartIndexMaintenance (INDEX_STRIDE, INDEX_INTERVAL_MS);
+
+			// Create opsPerThread nodes for each thread so they can't run out
+			std::vector<FRNode<int>*> preallocatedNodes (numThreads);
+			for (int i = 0; i < numThreads; i++)
+				preallocatedNodes[i] = new FRNode<int> [config.opsPerThread];
 
-	return times;
+			std::vector<FRThreadData<List>> threadData (numThreads);
+			for (int i = 0; i < numThreads; i++)
+			{
+				threadData[i].threadId = i;
+				threadData[i].seed = (unsigned int)rand ();
+				threadData[i].list = &list;
+				threadData[i].nodeArray = preallocatedNodes[i];
+				threadData[i].arrayIndex = 0;
+				threadData[i].opsPerThread = config.opsPerThread;
+				threadData[i].keyRange = config.keyRange;
+				threadData[i].addChance = addChance;
+				threadData[i].removeChance = removeChance;
+				threadData[i].containsChance = containsChance;
+				threadData[i].latencies.reserve (config.opsPerThread / LATENCY_SAMPLE_INTERVAL + 1);
+			}
+
+			std::vector<pthread_t> threads (numThreads);
+
+			std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now ();
+			// Spin off threads
+			for (int i = 0; i < numThreads; i++)
+				pthread_create (&threads[i], NULL, FRThreadLogic<List>, (void*)&threadData[i]);
+
+			// Join them back together
+			for (int i = 0; i < numThreads; i++)
+				pthread_join (threads[i], NULL);
+			std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now ();
+
+			if (useIndex)
+				list.StopIndexMaintenance ();
+
+			for (int i = 0; i < numThreads; i++)
+				delete [] preallocatedNodes[i];
+
+			std::vector<long> latencies;
+			for (int i = 0; i < numThreads; i++)
+				latencies.insert (latencies.end (), threadData[i].latencies.begin (), threadData[i].latencies.end ());
+
+			FRResult result;
+			result.variant = variant;
+			result.threads = numThreads;
+			result.addChance = addChance;
+			result.removeChance = removeChance;
+			result.containsChance = containsChance;
+			result.keyRange = config.keyRange;
+			result.ops = (long)numThreads * config.opsPerThread;
+			result.run = run;
+			result.seconds = std::chrono::duration<double> (end - begin).count ();
+			result.throughput = result.ops / result.seconds;
+			result.p50 = Percentile (latencies, 50);
+			result.p90 = Percentile (latencies, 90);
+			result.p99 = Percentile (latencies, 99);
+			result.max = Percentile (latencies, 100);
+			results.push_back (result);
+
+			printf ("%d threads, run %d: %lf s, %.0lf ops/s, p50 %ld ns, p99 %ld ns\n",
+				numThreads, run, result.seconds, result.throughput, result.p50, result.p99);
+		}
+	}
 }
 
-void FRTests ()
+template <class List>
+void FRTests (std::vector<FRResult>& results, const BenchConfig& config, const char* variant, bool useIndex)
 {
-	double* results = new double [3];
 	// Test 1 - 34% Add, 33% Remove, 33% Contains
-	FRDoTest (&results[0], 340, 330, 330);
+	FRDoTest<List> (results, config, variant, useIndex, 340, 330, 330);
 
 	// Test 2 - 50% Add, 50% Remove, 0% Contains
-	FRDoTest (&results[1], 500, 500, 0);
+	FRDoTest<List> (results, config, variant, useIndex, 500, 500, 0);
 
 	// Test 3 - 25% Add, 25% Remove, 50% Contains
-	FRDoTest (&results[2], 250, 250, 500);
+	FRDoTest<List> (results, config, variant, useIndex, 250, 250, 500);
+}
+
+std::string HostName ()
+{
+	char name [256];
+	if (gethostname (name, sizeof (name)) != 0)
+		return "unknown";
+	name[sizeof (name) - 1] = '\0';
+	return name;
+}
+
+// Keeps free form strings from breaking the JSON or CSV structure
+std::string Sanitize (const std::string& value)
+{
+	std::string clean;
+	for (size_t i = 0; i < value.size (); i++)
+		if (value[i] != '"' && value[i] != '\\' && value[i] != ',' && value[i] >= ' ')
+			clean += value[i];
+	return clean;
+}
+
+bool WriteJson (const char* path, const std::vector<FRResult>& results)
+{
+	FILE* file = fopen (path, "w");
+	if (file == NULL)
+		return false;
+
+	fprintf (file, "{\n");
+	fprintf (file, "  \"host\": {\"name\": \"%s\", \"cpus\": %ld, \"compiler\": \"%s\", \"timestamp\": %ld},\n",
+		Sanitize (HostName ()).c_str (), sysconf (_SC_NPROCESSORS_ONLN), Sanitize (__VERSION__).c_str (), (long)time (NULL));
+	fprintf (file, "  \"results\": [\n");
+	for (size_t i = 0; i < results.size (); i++)
+	{
+		const FRResult& r = results[i];
+		fprintf (file, "    {\"variant\": \"%s\", \"threads\": %d, \"add\": %d, \"remove\": %d, \"contains\": %d, \"key_range\": %d, "
+			"\"ops\": %ld, \"run\": %d, \"seconds\": %lf, \"throughput\": %lf, \"p50_ns\": %ld, \"p90_ns\": %ld, \"p99_ns\": %ld, \"max_ns\": %ld}%s\n",
+			Sanitize (r.variant).c_str (), r.threads, r.addChance, r.removeChance, r.containsChance, r.keyRange,
+			r.ops, r.run, r.seconds, r.throughput, r.p50, r.p90, r.p99, r.max, (i + 1 < results.size ()) ? "," : "");
+	}
+	fprintf (file, "  ]\n}\n");
 
-	printf ("Test 1: %lf\nTest 2: %ld\nTest 3: %lf\n", results[0], results[1], results[2]);
+	return fclose (file) == 0;
 }
 
-int main ()
+bool WriteCsv (const char* path, const std::vector<FRResult>& results)
 {
-	printf (".\n");
+	FILE* file = fopen (path, "w");
+	if (file == NULL)
+		return false;
+
+	std::string host = Sanitize (HostName ());
+	long cpus = sysconf (_SC_NPROCESSORS_ONLN);
+
+	fprintf (file, "variant,threads,add,remove,contains,key_range,ops,run,seconds,throughput,p50_ns,p90_ns,p99_ns,max_ns,host,cpus\n");
+	for (size_t i = 0; i < results.size (); i++)
+	{
+		const FRResult& r = results[i];
+		fprintf (file, "%s,%d,%d,%d,%d,%d,%ld,%d,%lf,%lf,%ld,%ld,%ld,%ld,%s,%ld\n",
+			Sanitize (r.variant).c_str (), r.threads, r.addChance, r.removeChance, r.containsChance, r.keyRange,
+			r.ops, r.run, r.seconds, r.throughput, r.p50, r.p90, r.p99, r.max, host.c_str (), cpus);
+	}
+
+	return fclose (file) == 0;
+}
+
+void PrintUsage (const char* program)
+{
+	printf ("Usage: %s [--variant default|backoff|index|combining|all] [--runs N] [--ops N] [--range N] [--json FILE] [--csv FILE]\n", program);
+}
+
+int main (int argc, char** argv)
+{
+	BenchConfig config;
+	config.runs = RUNS;
+	config.opsPerThread = OPS_PER_THREAD;
+	config.keyRange = KEY_RANGE;
+	config.variant = "all";
+	config.jsonPath = NULL;
+	config.csvPath = NULL;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (i + 1 < argc && strcmp (argv[i], "--variant") == 0)
+			config.variant = argv[++i];
+		else if (i + 1 < argc && strcmp (argv[i], "--runs") == 0)
+			config.runs = atoi (argv[++i]);
+		else if (i + 1 < argc && strcmp (argv[i], "--ops") == 0)
+			config.opsPerThread = atoi (argv[++i]);
+		else if (i + 1 < argc && strcmp (argv[i], "--range") == 0)
+			config.keyRange = atoi (argv[++i]);
+		else if (i + 1 < argc && strcmp (argv[i], "--json") == 0)
+			config.jsonPath = argv[++i];
+		else if (i + 1 < argc && strcmp (argv[i], "--csv") == 0)
+			config.csvPath = argv[++i];
+		else
+		{
+			PrintUsage (argv[0]);
+			return 2;
+		}
+	}
+
+	if (config.runs < 1 || config.opsPerThread < 1 || config.keyRange < 2)
+	{
+		PrintUsage (argv[0]);
+		return 2;
+	}
+
 	srand (time(NULL));
 
+	std::vector<FRResult> results;
+	bool all = strcmp (config.variant, "all") == 0;
+
 	printf ("Starting FRList Tests\n");
-	FRTests ();
+	if (all || strcmp (config.variant, "default") == 0)
+		FRTests<FRList<int> > (results, config, "default", false);
+	if (all || strcmp (config.variant, "backoff") == 0)
+		FRTests<FRList<int, BackoffPolicy> > (results, config, "backoff", false);
+	if (all || strcmp (config.variant, "index") == 0)
+		FRTests<FRList<int> > (results, config, "index", true);
+	if (all || strcmp (config.variant, "combining") == 0)
+		FRTests<FRList<int, CombiningPolicy> > (results, config, "combining", false);
+
+	if (results.empty ())
+	{
+		printf ("[ERROR] Unknown variant %s\n", config.variant);
+		return 2;
+	}
+
+	if (config.jsonPath != NULL && !WriteJson (config.jsonPath, results))
+	{
+		printf ("[ERROR] Could not write %s\n", config.jsonPath);
+		return 1;
+	}
+
+	if (config.csvPath != NULL && !WriteCsv (config.csvPath, results))
+	{
+		printf ("[ERROR] Could not write %s\n", config.csvPath);
+		return 1;
+	}
 
 	return 0;
-}
\ No newline at end of file
+}